@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <glfw-3.3.7/include/GLFW/glfw3.h>
 #include <stdio.h>
+#include <string.h>
 #include "commonTypes.h"
 #include "main.h"
 
@@ -55,7 +56,7 @@ void createShader()
 	if (!success)
 	{
 		glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-		printf("ERROR::SHADER::VERTEX::COMPILATION_FAILED\n");
+		fprintf(stderr, "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n");
 	}
 	// fragment shader
 	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -66,7 +67,7 @@ void createShader()
 	if (!success)
 	{
 		glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-		printf("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n");
+		fprintf(stderr, "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n");
 	}
 
 	// link shaders
@@ -78,7 +79,7 @@ void createShader()
 	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-		printf("ERROR::SHADER::PROGRAM::LINKING_FAILED\n");
+		fprintf(stderr, "ERROR::SHADER::PROGRAM::LINKING_FAILED\n");
 	}
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
@@ -120,27 +121,152 @@ int OpenWindow(int iWidth, int iHeight)
 	return 1;
 }
 
-void getTexture()
+// frames are streamed through a ring of pixel buffers, the texture reads from one while the next is filled
+#define VIEWER_PBO_COUNT (3)
+#define VIEWER_SYNC_TIMEOUT (1000000000) // ns
+
+unsigned int pixelBuffers[VIEWER_PBO_COUNT];
+GLsync pixelBufferFences[VIEWER_PBO_COUNT];
+char* pixelBufferMappings[VIEWER_PBO_COUNT]; // persistent mappings, NULL when buffers are orphaned instead
+int pixelBufferIndex = 0;
+size_t pixelBufferSize = 0;
+int textureWidth = 0;
+int textureHeight = 0;
+int textureBytesPerPixel = 0;
+
+void releasePixelBuffers()
 {
+	for (int i = 0; i < VIEWER_PBO_COUNT; i++)
+	{
+		if (pixelBufferFences[i])
+			glDeleteSync(pixelBufferFences[i]);
+		pixelBufferFences[i] = NULL;
+		if (pixelBufferMappings[i])
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			pixelBufferMappings[i] = NULL;
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (pixelBuffers[0])
+		glDeleteBuffers(VIEWER_PBO_COUNT, pixelBuffers);
+	for (int i = 0; i < VIEWER_PBO_COUNT; i++)
+		pixelBuffers[i] = 0;
+	pixelBufferSize = 0;
+}
 
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void allocatePixelBuffers(size_t size)
+{
+	releasePixelBuffers();
+	glGenBuffers(VIEWER_PBO_COUNT, pixelBuffers);
+	for (int i = 0; i < VIEWER_PBO_COUNT; i++)
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[i]);
+		if (GLAD_GL_VERSION_4_4)
+		{
+			// immutable storage stays mapped, fences keep the CPU off a buffer the GPU still reads
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+			pixelBufferMappings[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+		}
+		else
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	pixelBufferIndex = 0;
+	pixelBufferSize = size;
+}
 
-	if (textureData)
+// copies the frame into the next pixel buffer, NULL when it could not be mapped
+char* mapPixelBuffer(int index, size_t size)
+{
+	if (pixelBufferMappings[index])
 	{
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, RENDER_WIDTH, RENDER_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, textureData);
+		if (pixelBufferFences[index])
+		{
+			glClientWaitSync(pixelBufferFences[index], GL_SYNC_FLUSH_COMMANDS_BIT, VIEWER_SYNC_TIMEOUT);
+			glDeleteSync(pixelBufferFences[index]);
+			pixelBufferFences[index] = NULL;
+		}
+		return pixelBufferMappings[index];
 	}
-	else
+	// orphaning hands the old storage to the driver, the map never waits on a pending upload
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+	return glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+}
+
+// only the region changed since the last frame is uploaded, nothing when dirtyRect is empty
+void getTexture(const pixelRect* dirtyRect)
+{
+	if (!textureData)
 	{
-		printf("Failed to load texture");
+		fprintf(stderr, "Failed to load texture");
+		return;
 	}
-	//free(textureData);
 
+	GLenum format = textureDataBytesPerPixel == 4 ? GL_RGBA : GL_RGB;
+	// framebuffer rows are padded to FRAMEBUFFER_ROW_ALIGNMENT
+	size_t size = (size_t)textureDataStride * textureDataHeight;
+	pixelRect rect = *dirtyRect;
+	if (!texture)
+	{
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	else
+		glBindTexture(GL_TEXTURE_2D, texture);
 
+	// storage is only reallocated when the framebuffer changes
+	if (textureWidth != textureDataWidth || textureHeight != textureDataHeight || textureBytesPerPixel != textureDataBytesPerPixel)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureDataWidth, textureDataHeight, 0, format, GL_UNSIGNED_BYTE, NULL);
+		textureWidth = textureDataWidth;
+		textureHeight = textureDataHeight;
+		textureBytesPerPixel = textureDataBytesPerPixel;
+		rect = (pixelRect){ 0, 0, textureDataWidth, textureDataHeight };
+	}
+	if (isRectEmpty(&rect))
+		return;
+	if (pixelBufferSize != size)
+		allocatePixelBuffers(size);
+
+	// the rows of the rectangle keep their offset, so the full frame row length selects them
+	glPixelStorei(GL_UNPACK_ALIGNMENT, FRAMEBUFFER_ROW_ALIGNMENT);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, textureDataWidth);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.minX);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.minY);
+	size_t offset = (size_t)textureDataStride * rect.minY;
+	size_t rowsSize = (size_t)textureDataStride * (rect.maxY - rect.minY);
+	int index = pixelBufferIndex;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[index]);
+	char* pixels = mapPixelBuffer(index, size);
+	if (pixels)
+	{
+		memcpy(pixels + offset, textureData + offset, rowsSize);
+		if (!pixelBufferMappings[index])
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		// the upload is sourced from the buffer, the driver copies it while the CPU moves on
+		glTexSubImage2D(GL_TEXTURE_2D, 0, rect.minX, rect.minY, rect.maxX - rect.minX, rect.maxY - rect.minY,
+			format, GL_UNSIGNED_BYTE, 0);
+		if (pixelBufferMappings[index])
+			pixelBufferFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		pixelBufferIndex = (index + 1) % VIEWER_PBO_COUNT;
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else
+	{
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, rect.minX, rect.minY, rect.maxX - rect.minX, rect.maxY - rect.minY,
+			format, GL_UNSIGNED_BYTE, textureData);
+	}
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 }
 
 void OpenGLInit()
@@ -169,12 +295,12 @@ void OpenGLInit()
 
 }
 
-void MainLoop()
+void MainLoop(const pixelRect* dirtyRect)
 {
 	glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
 	glUseProgram(shaderProgram);
 
-	getTexture();
+	getTexture(dirtyRect);
 	glActiveTexture(0);
 	glBindTexture(GL_TEXTURE_2D, texture);
 	glUniform1i(glGetUniformLocation(shaderProgram, "renderedTexture"), 0);
@@ -184,3 +310,15 @@ void MainLoop()
 	glBindVertexArray(VAO);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 }
+
+void OpenGLRelease()
+{
+	releasePixelBuffers();
+	if (texture)
+		glDeleteTextures(1, &texture);
+	texture = 0;
+	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteProgram(shaderProgram);
+}
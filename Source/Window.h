@@ -1,10 +1,11 @@
 #pragma once
 
-void MainLoop();
+void MainLoop(const pixelRect* dirtyRect);
 int OpenWindow(int iWidth, int iHeight);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void getTexture();
+void getTexture(const pixelRect* dirtyRect);
 void createShader();
 void OpenGLInit();
+void OpenGLRelease();
 
 GLFWwindow* window;
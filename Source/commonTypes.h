@@ -24,5 +24,12 @@ typedef struct
 #define WINDOW_HEIGHT      (1024)
 #define RENDER_WIDTH       (512)
 #define RENDER_HEIGHT      (512)
-#define NUMBER_OF_CHANNELS (3)
+
+// portable replacements for the MSVC min/max macros, arguments are evaluated twice
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 
@@ -0,0 +1,567 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "framebuffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAMEBUFFER_SSE2
+#endif
+
+#ifdef _WIN64
+#include <malloc.h>
+#endif
+
+static void* alignedCalloc(size_t size)
+{
+	size = (size + FRAMEBUFFER_ALIGNMENT - 1) / FRAMEBUFFER_ALIGNMENT * FRAMEBUFFER_ALIGNMENT;
+#ifdef _WIN64
+	void* buffer = _aligned_malloc(size, FRAMEBUFFER_ALIGNMENT);
+#else
+	void* buffer = aligned_alloc(FRAMEBUFFER_ALIGNMENT, size);
+#endif
+	if (buffer)
+		memset(buffer, 0, size);
+	return buffer;
+}
+
+static void alignedFree(void* buffer)
+{
+#ifdef _WIN64
+	_aligned_free(buffer);
+#else
+	free(buffer);
+#endif
+}
+
+int getBytesPerPixel(int format)
+{
+	switch (format)
+	{
+	case FORMAT_RGB8:
+		return 3;
+	case FORMAT_RGBA8:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+int getBytesPerDepthSample(int depthFormat)
+{
+	switch (depthFormat)
+	{
+	case DEPTH_D16:
+		return 2;
+	case DEPTH_D24:
+	case DEPTH_D32F:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+// standard 2x and 4x sample positions relative to the pixel
+static const float sampleOffsets1[1][2] = { { 0.0f, 0.0f } };
+static const float sampleOffsets2[2][2] = { { 0.25f, 0.25f }, { -0.25f, -0.25f } };
+static const float sampleOffsets4[4][2] = {
+	{ -0.125f, -0.375f }, { 0.375f, -0.125f }, { -0.375f, 0.125f }, { 0.125f, 0.375f } };
+
+const float (*getSampleOffsets(int sampleCount))[2]
+{
+	switch (sampleCount)
+	{
+	case 2:
+		return sampleOffsets2;
+	case 4:
+		return sampleOffsets4;
+	default:
+		return sampleOffsets1;
+	}
+}
+
+int createFramebuffer(Framebuffer* framebuffer, int width, int height, int format,
+	int depthFormat, int sampleCount, int hasVisibilityBuffer)
+{
+	memset(framebuffer, 0, sizeof(Framebuffer));
+	if (width <= 0 || height <= 0 || getBytesPerPixel(format) == 0 || getBytesPerDepthSample(depthFormat) == 0)
+		return 0;
+	if (sampleCount != 1 && sampleCount != 2 && sampleCount != 4)
+		return 0;
+
+	framebuffer->width = width;
+	framebuffer->height = height;
+	framebuffer->format = format;
+	framebuffer->bytesPerPixel = getBytesPerPixel(format);
+	framebuffer->depthFormat = depthFormat;
+	framebuffer->sampleCount = sampleCount;
+	setDepthState(framebuffer, DEPTH_GREATER, 1);
+	framebuffer->stride = (width * framebuffer->bytesPerPixel + FRAMEBUFFER_ROW_ALIGNMENT - 1) /
+		FRAMEBUFFER_ROW_ALIGNMENT * FRAMEBUFFER_ROW_ALIGNMENT;
+	framebuffer->tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	framebuffer->tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+	framebuffer->color = alignedCalloc((size_t)framebuffer->stride * height);
+	framebuffer->depth = alignedCalloc((size_t)width * height * sampleCount * getBytesPerDepthSample(depthFormat));
+	framebuffer->tileClearFlags = calloc(framebuffer->tilesX * framebuffer->tilesY, sizeof(unsigned char));
+	framebuffer->tileDirtyFlags = malloc(framebuffer->tilesX * framebuffer->tilesY);
+	if (framebuffer->tileDirtyFlags)
+		memset(framebuffer->tileDirtyFlags, 1, framebuffer->tilesX * framebuffer->tilesY);
+	if (hasVisibilityBuffer)
+		framebuffer->visibility = alignedCalloc((size_t)width * height * sampleCount * sizeof(visibilitySample));
+	if (sampleCount > 1)
+		framebuffer->sampleColor = alignedCalloc((size_t)width * height * sampleCount * framebuffer->bytesPerPixel);
+
+	if (!framebuffer->color || !framebuffer->depth || !framebuffer->tileClearFlags || !framebuffer->tileDirtyFlags ||
+		(hasVisibilityBuffer && !framebuffer->visibility) || (sampleCount > 1 && !framebuffer->sampleColor))
+	{
+		destroyFramebuffer(framebuffer);
+		return 0;
+	}
+	return 1;
+}
+
+void destroyFramebuffer(Framebuffer* framebuffer)
+{
+	alignedFree(framebuffer->color);
+	alignedFree(framebuffer->depth);
+	alignedFree(framebuffer->visibility);
+	alignedFree(framebuffer->sampleColor);
+	free(framebuffer->tileClearFlags);
+	free(framebuffer->tileDirtyFlags);
+	free(framebuffer->depthTiles);
+	memset(framebuffer, 0, sizeof(Framebuffer));
+}
+
+// depthCompare has to match the direction of isReversedZ, near is greater with reversed z
+void setDepthState(Framebuffer* framebuffer, int depthCompare, int isReversedZ)
+{
+	framebuffer->depthCompare = depthCompare;
+	framebuffer->isReversedZ = isReversedZ;
+}
+
+// With depth compression the depth of a tile is kept as the planes of the
+// triangles covering it, see compressedDepthTile.
+int setDepthCompression(Framebuffer* framebuffer, int isEnabled)
+{
+	if (!isEnabled)
+	{
+		decompressDepth(framebuffer);
+		free(framebuffer->depthTiles);
+		framebuffer->depthTiles = NULL;
+		return 1;
+	}
+	if (framebuffer->depthTiles)
+		return 1;
+
+	// tiles start uncompressed, the current depth buffer stays valid until the next clear
+	framebuffer->depthTiles = calloc(framebuffer->tilesX * framebuffer->tilesY, sizeof(compressedDepthTile));
+	framebuffer->nextDepthPlaneId = 1;
+	return framebuffer->depthTiles != NULL;
+}
+
+// depth value as it is stored by the depth format
+static float quantizeDepth(Framebuffer* framebuffer, float depth)
+{
+	switch (framebuffer->depthFormat)
+	{
+	case DEPTH_D16:
+		return (float)(unsigned short)(depth * 65535.0f + 0.5f);
+	case DEPTH_D24:
+		return (float)(unsigned int)(depth * 16777215.0f + 0.5f);
+	default:
+		return depth;
+	}
+}
+
+static void storeDepth(Framebuffer* framebuffer, size_t index, float depth)
+{
+	switch (framebuffer->depthFormat)
+	{
+	case DEPTH_D16:
+		((unsigned short*)framebuffer->depth)[index] = (unsigned short)(depth * 65535.0f + 0.5f);
+		break;
+	case DEPTH_D24:
+		((unsigned int*)framebuffer->depth)[index] = (unsigned int)(depth * 16777215.0f + 0.5f);
+		break;
+	default:
+		((float*)framebuffer->depth)[index] = depth;
+		break;
+	}
+}
+
+static float evaluateDepthPlane(const depthPlane* plane, float x, float y)
+{
+	float depth = plane->a * x + plane->b * y + plane->c;
+	return depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+}
+
+// Plane through the vertices of a triangle in screen space. Fails for degenerate
+// triangles and for triangles crossing the near or far plane, where the depth is clamped.
+int createDepthPlane(Framebuffer* framebuffer, ivec2 screenP1, ivec2 screenP2, ivec2 screenP3,
+	float zValue1, float zValue2, float zValue3, depthPlane* plane)
+{
+	if (zValue1 < -1.0f || zValue1 > 1.0f || zValue2 < -1.0f || zValue2 > 1.0f || zValue3 < -1.0f || zValue3 > 1.0f)
+		return 0;
+
+	double depth1 = getNormalizedDepth(framebuffer, zValue1);
+	double depth21 = getNormalizedDepth(framebuffer, zValue2) - depth1;
+	double depth31 = getNormalizedDepth(framebuffer, zValue3) - depth1;
+	double x21 = screenP2[0] - screenP1[0], y21 = screenP2[1] - screenP1[1];
+	double x31 = screenP3[0] - screenP1[0], y31 = screenP3[1] - screenP1[1];
+	double denom = x21 * y31 - x31 * y21;
+	if (denom == 0.0)
+		return 0;
+
+	double a = (depth21 * y31 - depth31 * y21) / denom;
+	double b = (x21 * depth31 - x31 * depth21) / denom;
+	plane->a = (float)a;
+	plane->b = (float)b;
+	plane->c = (float)(depth1 - a * screenP1[0] - b * screenP1[1]);
+	// id 0 is the plane of the depth clear
+	if (framebuffer->nextDepthPlaneId == INT_MAX)
+		framebuffer->nextDepthPlaneId = 1;
+	plane->id = framebuffer->nextDepthPlaneId++;
+	return 1;
+}
+
+// every sample of the tile selects the plane of the clear depth
+static void resetDepthTile(Framebuffer* framebuffer, int tileX, int tileY)
+{
+	compressedDepthTile* tile = &framebuffer->depthTiles[tileX + tileY * framebuffer->tilesX];
+	int width = MIN(TILE_SIZE, framebuffer->width - tileX * TILE_SIZE);
+	int height = MIN(TILE_SIZE, framebuffer->height - tileY * TILE_SIZE);
+
+	tile->isCompressed = 1;
+	tile->planes[0].a = 0.0f;
+	tile->planes[0].b = 0.0f;
+	tile->planes[0].c = getNormalizedDepth(framebuffer, framebuffer->clearDepth);
+	tile->planes[0].id = 0;
+	tile->planeSamples[0] = width * height * framebuffer->sampleCount;
+	for (int i = 1; i < DEPTH_TILE_MAX_PLANES; i++)
+		tile->planeSamples[i] = 0;
+	memset(tile->selector, 0, sizeof(tile->selector));
+}
+
+// writes the planes of a compressed tile into the depth buffer
+static void expandDepthTile(Framebuffer* framebuffer, int tileX, int tileY)
+{
+	compressedDepthTile* tile = &framebuffer->depthTiles[tileX + tileY * framebuffer->tilesX];
+	const float (*offsets)[2] = getSampleOffsets(framebuffer->sampleCount);
+	int sampleCount = framebuffer->sampleCount;
+	int minX = tileX * TILE_SIZE;
+	int minY = tileY * TILE_SIZE;
+	int maxX = MIN(minX + TILE_SIZE, framebuffer->width);
+	int maxY = MIN(minY + TILE_SIZE, framebuffer->height);
+
+	for (int y = minY; y < maxY; y++)
+	{
+		for (int x = minX; x < maxX; x++)
+		{
+			for (int s = 0; s < sampleCount; s++)
+			{
+				int tileSample = ((y - minY) * TILE_SIZE + x - minX) * sampleCount + s;
+				int selected = (tile->selector[tileSample / 4] >> (tileSample % 4 * 2)) & 3;
+				float depth = evaluateDepthPlane(&tile->planes[selected], x + offsets[s][0], y + offsets[s][1]);
+				storeDepth(framebuffer, ((size_t)y * framebuffer->width + x) * sampleCount + s, depth);
+			}
+		}
+	}
+	tile->isCompressed = 0;
+}
+
+// Depth test of a sample of a triangle, plane is the depth plane of the triangle
+// or NULL when it has none. Without depth compression this is testDepth.
+int testDepthSample(Framebuffer* framebuffer, int x, int y, int sample, float zValue, const depthPlane* plane)
+{
+	int index = (x + y * framebuffer->width) * framebuffer->sampleCount + sample;
+	if (!framebuffer->depthTiles)
+		return testDepth(framebuffer, index, zValue);
+
+	int tileX = x / TILE_SIZE;
+	int tileY = y / TILE_SIZE;
+	compressedDepthTile* tile = &framebuffer->depthTiles[tileX + tileY * framebuffer->tilesX];
+	if (!tile->isCompressed)
+		return testDepth(framebuffer, index, zValue);
+
+	const float* offset = getSampleOffsets(framebuffer->sampleCount)[sample];
+	int tileSample = ((y - tileY * TILE_SIZE) * TILE_SIZE + x - tileX * TILE_SIZE) * framebuffer->sampleCount + sample;
+	int shift = tileSample % 4 * 2;
+	int selected = (tile->selector[tileSample / 4] >> shift) & 3;
+	float storedDepth = evaluateDepthPlane(&tile->planes[selected], x + offset[0], y + offset[1]);
+	float depth = getNormalizedDepth(framebuffer, zValue);
+	if (!compareDepth(framebuffer->depthCompare, quantizeDepth(framebuffer, depth), quantizeDepth(framebuffer, storedDepth)))
+		return 0;
+
+	// the sample selects the plane of the triangle, a free plane is taken when it is not in the tile yet
+	int planeIndex = -1;
+	if (plane)
+	{
+		for (int i = 0; i < DEPTH_TILE_MAX_PLANES && planeIndex < 0; i++)
+		{
+			if (tile->planeSamples[i] > 0 && tile->planes[i].id == plane->id)
+				planeIndex = i;
+		}
+		for (int i = 0; i < DEPTH_TILE_MAX_PLANES && planeIndex < 0; i++)
+		{
+			if (tile->planeSamples[i] == 0 || (i == selected && tile->planeSamples[i] == 1))
+			{
+				planeIndex = i;
+				tile->planes[i] = *plane;
+			}
+		}
+	}
+	if (planeIndex < 0)
+	{
+		expandDepthTile(framebuffer, tileX, tileY);
+		return testDepth(framebuffer, index, zValue);
+	}
+
+	tile->planeSamples[selected]--;
+	tile->planeSamples[planeIndex]++;
+	tile->selector[tileSample / 4] = (unsigned char)((tile->selector[tileSample / 4] & ~(3 << shift)) | (planeIndex << shift));
+	return 1;
+}
+
+// expands every compressed tile so the depth buffer can be read directly
+void decompressDepth(Framebuffer* framebuffer)
+{
+	if (!framebuffer->depthTiles)
+		return;
+
+	resolveFramebuffer(framebuffer);
+	for (int tileY = 0; tileY < framebuffer->tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < framebuffer->tilesX; tileX++)
+		{
+			if (framebuffer->depthTiles[tileX + tileY * framebuffer->tilesX].isCompressed)
+				expandDepthTile(framebuffer, tileX, tileY);
+		}
+	}
+}
+
+// O(tiles), the pixels are written later by touchFramebufferRegion or resolveFramebuffer.
+// Tiles still holding the clear values are not flagged, their pixels are kept.
+void clearFramebuffer(Framebuffer* framebuffer, int flags)
+{
+	int numOfTiles = framebuffer->tilesX * framebuffer->tilesY;
+	if (!framebuffer->visibility)
+		flags &= ~TILE_CLEAR_VISIBILITY;
+
+	// tiles filled with other clear values have to be written again
+	if (((flags & TILE_CLEAR_COLOR) && memcmp(framebuffer->clearColor, framebuffer->filledClearColor, 4) != 0) ||
+		((flags & TILE_CLEAR_DEPTH) && framebuffer->clearDepth != framebuffer->filledClearDepth))
+	{
+		memset(framebuffer->tileDirtyFlags, 1, numOfTiles);
+		memcpy(framebuffer->filledClearColor, framebuffer->clearColor, 4);
+		framebuffer->filledClearDepth = framebuffer->clearDepth;
+	}
+	if (flags & TILE_CLEAR_COLOR)
+		framebuffer->drawnRect = (pixelRect){ 0, 0, 0, 0 };
+
+	for (int i = 0; i < numOfTiles; i++)
+	{
+		if (framebuffer->tileDirtyFlags[i])
+			framebuffer->tileClearFlags[i] |= flags;
+	}
+}
+
+// fills a row of 32-bit pixels, four pixels per store with SSE2
+static void fillRow32(unsigned char* row, const unsigned char* value, int count)
+{
+	uint32_t pixel;
+	memcpy(&pixel, value, 4);
+
+	int x = 0;
+#ifdef FRAMEBUFFER_SSE2
+	__m128i pixels = _mm_set1_epi32((int)pixel);
+	for (; x + 4 <= count; x += 4)
+		_mm_storeu_si128((__m128i*)(row + x * 4), pixels);
+#endif
+	for (; x < count; x++)
+		memcpy(row + x * 4, &pixel, 4);
+}
+
+static void fillColorRow(Framebuffer* framebuffer, unsigned char* row, int count)
+{
+	int bytesPerPixel = framebuffer->bytesPerPixel;
+	if (bytesPerPixel == 4)
+		fillRow32(row, framebuffer->clearColor, count);
+	else
+		for (int x = 0; x < count; x++)
+			memcpy(&row[x * bytesPerPixel], framebuffer->clearColor, bytesPerPixel);
+}
+
+static void fillTile(Framebuffer* framebuffer, int tileX, int tileY)
+{
+	unsigned char* flags = &framebuffer->tileClearFlags[tileX + tileY * framebuffer->tilesX];
+	int minX = tileX * TILE_SIZE;
+	int minY = tileY * TILE_SIZE;
+	int maxX = MIN(minX + TILE_SIZE, framebuffer->width);
+	int maxY = MIN(minY + TILE_SIZE, framebuffer->height);
+	int bytesPerPixel = framebuffer->bytesPerPixel;
+	int sampleCount = framebuffer->sampleCount;
+	// depth, visibility and sample colors hold sampleCount entries per pixel
+	int numOfSamples = (maxX - minX) * sampleCount;
+
+	for (int y = minY; y < maxY; y++)
+	{
+		size_t sampleIndex = ((size_t)y * framebuffer->width + minX) * sampleCount;
+		if (*flags & TILE_CLEAR_COLOR)
+		{
+			fillColorRow(framebuffer, &framebuffer->color[y * framebuffer->stride + minX * bytesPerPixel], maxX - minX);
+			if (framebuffer->sampleColor)
+				fillColorRow(framebuffer, &framebuffer->sampleColor[sampleIndex * bytesPerPixel], numOfSamples);
+		}
+		if ((*flags & TILE_CLEAR_DEPTH) && !framebuffer->depthTiles)
+		{
+			float depth = getNormalizedDepth(framebuffer, framebuffer->clearDepth);
+			size_t index = sampleIndex;
+			if (framebuffer->depthFormat == DEPTH_D16)
+			{
+				unsigned short* row = (unsigned short*)framebuffer->depth + index;
+				for (int x = 0; x < numOfSamples; x++)
+					row[x] = (unsigned short)(depth * 65535.0f + 0.5f);
+			}
+			else if (framebuffer->depthFormat == DEPTH_D24)
+			{
+				unsigned int* row = (unsigned int*)framebuffer->depth + index;
+				for (int x = 0; x < numOfSamples; x++)
+					row[x] = (unsigned int)(depth * 16777215.0f + 0.5f);
+			}
+			else
+			{
+				float* row = (float*)framebuffer->depth + index;
+				for (int x = 0; x < numOfSamples; x++)
+					row[x] = depth;
+			}
+		}
+		if (*flags & TILE_CLEAR_VISIBILITY)
+		{
+			visibilitySample* row = &framebuffer->visibility[sampleIndex];
+			for (int x = 0; x < numOfSamples; x++)
+				row[x].triangleId = NO_TRIANGLE;
+		}
+	}
+	if ((*flags & TILE_CLEAR_DEPTH) && framebuffer->depthTiles)
+		resetDepthTile(framebuffer, tileX, tileY);
+	// the tile is clean once every buffer holds the clear values
+	int allFlags = TILE_CLEAR_COLOR | TILE_CLEAR_DEPTH | (framebuffer->visibility ? TILE_CLEAR_VISIBILITY : 0);
+	if ((*flags & allFlags) == allFlags && memcmp(framebuffer->clearColor, framebuffer->filledClearColor, 4) == 0 &&
+		framebuffer->clearDepth == framebuffer->filledClearDepth)
+		framebuffer->tileDirtyFlags[tileX + tileY * framebuffer->tilesX] = 0;
+	*flags = 0;
+}
+
+// writes the pending clears of all tiles overlapping the region, called before drawing into it
+void touchFramebufferRegion(Framebuffer* framebuffer, int minX, int minY, int maxX, int maxY)
+{
+	int minTileX = MAX(0, minX / TILE_SIZE);
+	int minTileY = MAX(0, minY / TILE_SIZE);
+	int maxTileX = MIN(framebuffer->tilesX - 1, maxX / TILE_SIZE);
+	int maxTileY = MIN(framebuffer->tilesY - 1, maxY / TILE_SIZE);
+	if (minTileX > maxTileX || minTileY > maxTileY)
+		return;
+
+	for (int tileY = minTileY; tileY <= maxTileY; tileY++)
+	{
+		for (int tileX = minTileX; tileX <= maxTileX; tileX++)
+		{
+			int tile = tileX + tileY * framebuffer->tilesX;
+			if (framebuffer->tileClearFlags[tile])
+				fillTile(framebuffer, tileX, tileY);
+			framebuffer->tileDirtyFlags[tile] = 1;
+		}
+	}
+	pixelRect rect = { minTileX * TILE_SIZE, minTileY * TILE_SIZE,
+		MIN((maxTileX + 1) * TILE_SIZE, framebuffer->width), MIN((maxTileY + 1) * TILE_SIZE, framebuffer->height) };
+	unionRect(&framebuffer->drawnRect, &rect);
+}
+
+// writes every pending clear so the buffers can be read directly,
+// compressed depth tiles are expanded only by decompressDepth
+void resolveFramebuffer(Framebuffer* framebuffer)
+{
+	for (int tileY = 0; tileY < framebuffer->tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < framebuffer->tilesX; tileX++)
+		{
+			if (framebuffer->tileClearFlags[tileX + tileY * framebuffer->tilesX])
+				fillTile(framebuffer, tileX, tileY);
+		}
+	}
+}
+
+// Multisample resolve, the color of a pixel is the average of its samples.
+// Tiles which are not drawn since the last clear are left to resolveFramebuffer,
+// clean tiles already hold the resolved clear color.
+void resolveMultisampleColor(Framebuffer* framebuffer)
+{
+	int sampleCount = framebuffer->sampleCount;
+	int bytesPerPixel = framebuffer->bytesPerPixel;
+	if (sampleCount == 1)
+		return;
+
+	for (int tileY = 0; tileY < framebuffer->tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < framebuffer->tilesX; tileX++)
+		{
+			if (isTileCleared(framebuffer, tileX, tileY, TILE_CLEAR_COLOR) ||
+				!framebuffer->tileDirtyFlags[tileX + tileY * framebuffer->tilesX])
+				continue;
+
+			int maxX = MIN((tileX + 1) * TILE_SIZE, framebuffer->width);
+			int maxY = MIN((tileY + 1) * TILE_SIZE, framebuffer->height);
+			for (int y = tileY * TILE_SIZE; y < maxY; y++)
+			{
+				for (int x = tileX * TILE_SIZE; x < maxX; x++)
+				{
+					unsigned char* samples = &framebuffer->sampleColor[((size_t)y * framebuffer->width + x) * sampleCount * bytesPerPixel];
+					unsigned char* pixel = &framebuffer->color[y * framebuffer->stride + x * bytesPerPixel];
+					for (int c = 0; c < bytesPerPixel; c++)
+					{
+						int sum = 0;
+						for (int s = 0; s < sampleCount; s++)
+							sum += samples[s * bytesPerPixel + c];
+						pixel[c] = (unsigned char)((sum + sampleCount / 2) / sampleCount);
+					}
+				}
+			}
+		}
+	}
+}
+
+// copies the resolved color buffer into a tightly packed RGB image
+void readFramebufferRGB(Framebuffer* framebuffer, unsigned char* rgb, int rgbStride)
+{
+	resolveFramebuffer(framebuffer);
+	for (int y = 0; y < framebuffer->height; y++)
+	{
+		unsigned char* source = &framebuffer->color[y * framebuffer->stride];
+		unsigned char* destination = &rgb[y * rgbStride];
+		if (framebuffer->format == FORMAT_RGB8)
+		{
+			memcpy(destination, source, framebuffer->width * 3);
+			continue;
+		}
+		for (int x = 0; x < framebuffer->width; x++)
+		{
+			destination[x * 3] = source[x * 4];
+			destination[x * 3 + 1] = source[x * 4 + 1];
+			destination[x * 3 + 2] = source[x * 4 + 2];
+		}
+	}
+}
+
+int isTileCleared(Framebuffer* framebuffer, int tileX, int tileY, int flags)
+{
+	return (framebuffer->tileClearFlags[tileX + tileY * framebuffer->tilesX] & flags) == flags;
+}
+
+// no triangle was drawn into the tile since the last visibility clear
+int isTileEmpty(Framebuffer* framebuffer, int tileX, int tileY)
+{
+	int tile = tileX + tileY * framebuffer->tilesX;
+	return !framebuffer->tileDirtyFlags[tile] || (framebuffer->tileClearFlags[tile] & TILE_CLEAR_VISIBILITY);
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include "commonTypes.h"
+
+#define TILE_SIZE (32)
+#define NO_TRIANGLE (-1)
+#define FRAMEBUFFER_ALIGNMENT (64) // buffers start on a cache line for SIMD loads and stores
+#define FRAMEBUFFER_ROW_ALIGNMENT (8) // largest GL_UNPACK_ALIGNMENT, rows can be uploaded as they are
+#define MAX_SAMPLES (4)
+#define DEPTH_TILE_MAX_PLANES (4) // the clear value and up to three triangles
+
+// FORMAT_RGBA8 packs a pixel in 32 bits, so it is written with one aligned store
+enum framebufferFormat { FORMAT_RGB8 = 0, FORMAT_RGBA8 = 1 };
+
+// DEPTH_D24 is stored in the low 24 bits of a 32-bit word
+enum depthFormat { DEPTH_D32F = 0, DEPTH_D24 = 1, DEPTH_D16 = 2 };
+enum depthCompare { DEPTH_LESS = 0, DEPTH_LEQUAL = 1, DEPTH_GREATER = 2, DEPTH_GEQUAL = 3, DEPTH_ALWAYS = 4 };
+
+// clears which are recorded for a tile but not written to its pixels yet
+enum tileClearFlags { TILE_CLEAR_COLOR = 1, TILE_CLEAR_DEPTH = 2, TILE_CLEAR_VISIBILITY = 4 };
+
+// visibility buffer sample, the first barycentric coord is 1 - barycentric1 - barycentric2
+typedef struct {
+	int triangleId;
+	float barycentric1;
+	float barycentric2;
+}visibilitySample;
+
+// pixel rectangle, maxX and maxY are exclusive, empty when minX >= maxX
+typedef struct {
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+}pixelRect;
+
+// Depth of a triangle over the sample positions, depth = a * x + b * y + c.
+// The id tells the planes of different triangles apart.
+typedef struct {
+	float a;
+	float b;
+	float c;
+	int id;
+}depthPlane;
+
+// A compressed depth tile stores the depth planes of the triangles covering it
+// and selects one of them with 2 bits per sample instead of the 16 or 32 bit
+// depth. The tile is expanded into the depth buffer when a fifth plane is needed
+// and stays uncompressed until the next depth clear.
+typedef struct {
+	int isCompressed;
+	depthPlane planes[DEPTH_TILE_MAX_PLANES];
+	int planeSamples[DEPTH_TILE_MAX_PLANES]; // samples selecting each plane, 0 marks a free plane
+	unsigned char selector[TILE_SIZE * TILE_SIZE * MAX_SAMPLES / 4];
+}compressedDepthTile;
+
+// Render target split into TILE_SIZE x TILE_SIZE tiles. A clear only flags
+// the tiles, the clear values are written to a tile the first time it is
+// touched by drawing or when the framebuffer is resolved for readback.
+typedef struct
+{
+	int width;
+	int height;
+	int stride; // bytes between color rows
+	int format;
+	int bytesPerPixel;
+	unsigned char* color;
+	// Multisampling keeps sampleCount depth, visibility and color entries per
+	// pixel, stored next to each other. The sample colors are averaged into
+	// color by resolveMultisampleColor.
+	int sampleCount;
+	unsigned char* sampleColor; // only allocated for multisampling
+	void* depth; // width x height x sampleCount, tightly packed
+	int depthFormat;
+	int depthCompare;
+	// Fragment depth is the NDC z of the renderer where near is 1 and far is -1.
+	// It is stored as a [0, 1] value, near at 0 and far at 1 unless isReversedZ
+	// is set, then near is 1 and far is 0.
+	int isReversedZ;
+	visibilitySample* visibility; // only allocated for visibility buffer shading
+	int tilesX;
+	int tilesY;
+	unsigned char* tileClearFlags;
+	unsigned char clearColor[4];
+	float clearDepth; // NDC z
+	// Only allocated with depth compression, depth is then the backing storage
+	// of the tiles which could not be compressed.
+	compressedDepthTile* depthTiles;
+	int nextDepthPlaneId;
+	// Tiles drawn since they were last filled with the clear values. A clear skips the
+	// clean tiles, so a static background is kept from frame to frame instead of rewritten.
+	unsigned char* tileDirtyFlags;
+	unsigned char filledClearColor[4];
+	float filledClearDepth;
+	pixelRect drawnRect; // tiles drawn since the last color clear
+}Framebuffer;
+
+int createFramebuffer(Framebuffer* framebuffer, int width, int height, int format,
+	int depthFormat, int sampleCount, int hasVisibilityBuffer);
+const float (*getSampleOffsets(int sampleCount))[2];
+void setDepthState(Framebuffer* framebuffer, int depthCompare, int isReversedZ);
+int setDepthCompression(Framebuffer* framebuffer, int isEnabled);
+int createDepthPlane(Framebuffer* framebuffer, ivec2 screenP1, ivec2 screenP2, ivec2 screenP3,
+	float zValue1, float zValue2, float zValue3, depthPlane* plane);
+int testDepthSample(Framebuffer* framebuffer, int x, int y, int sample, float zValue, const depthPlane* plane);
+void decompressDepth(Framebuffer* framebuffer);
+int getBytesPerPixel(int format);
+int getBytesPerDepthSample(int depthFormat);
+void destroyFramebuffer(Framebuffer* framebuffer);
+void clearFramebuffer(Framebuffer* framebuffer, int flags);
+void touchFramebufferRegion(Framebuffer* framebuffer, int minX, int minY, int maxX, int maxY);
+void resolveFramebuffer(Framebuffer* framebuffer);
+void resolveMultisampleColor(Framebuffer* framebuffer);
+void readFramebufferRGB(Framebuffer* framebuffer, unsigned char* rgb, int rgbStride);
+int isTileCleared(Framebuffer* framebuffer, int tileX, int tileY, int flags);
+int isTileEmpty(Framebuffer* framebuffer, int tileX, int tileY);
+
+static inline int isRectEmpty(const pixelRect* rect)
+{
+	return rect->minX >= rect->maxX || rect->minY >= rect->maxY;
+}
+
+static inline void unionRect(pixelRect* rect, const pixelRect* other)
+{
+	if (isRectEmpty(other))
+		return;
+	if (isRectEmpty(rect))
+	{
+		*rect = *other;
+		return;
+	}
+	rect->minX = MIN(rect->minX, other->minX);
+	rect->minY = MIN(rect->minY, other->minY);
+	rect->maxX = MAX(rect->maxX, other->maxX);
+	rect->maxY = MAX(rect->maxY, other->maxY);
+}
+
+// converts NDC z to the [0, 1] depth value of the framebuffer
+static inline float getNormalizedDepth(Framebuffer* framebuffer, float zValue)
+{
+	float depth = framebuffer->isReversedZ ? (zValue + 1.0f) * 0.5f : (1.0f - zValue) * 0.5f;
+	return depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+}
+
+static inline int compareDepth(int depthCompare, float depth, float storedDepth)
+{
+	switch (depthCompare)
+	{
+	case DEPTH_LESS:
+		return depth < storedDepth;
+	case DEPTH_LEQUAL:
+		return depth <= storedDepth;
+	case DEPTH_GREATER:
+		return depth > storedDepth;
+	case DEPTH_GEQUAL:
+		return depth >= storedDepth;
+	default:
+		return 1;
+	}
+}
+
+// depth test of a fragment, the depth is written when the test passes
+static inline int testDepth(Framebuffer* framebuffer, int index, float zValue)
+{
+	float depth = getNormalizedDepth(framebuffer, zValue);
+	switch (framebuffer->depthFormat)
+	{
+	case DEPTH_D16:
+	{
+		unsigned short* depthBuffer = (unsigned short*)framebuffer->depth;
+		unsigned short value = (unsigned short)(depth * 65535.0f + 0.5f);
+		if (!compareDepth(framebuffer->depthCompare, value, depthBuffer[index]))
+			return 0;
+		depthBuffer[index] = value;
+		return 1;
+	}
+	case DEPTH_D24:
+	{
+		unsigned int* depthBuffer = (unsigned int*)framebuffer->depth;
+		unsigned int value = (unsigned int)(depth * 16777215.0f + 0.5f);
+		if (!compareDepth(framebuffer->depthCompare, (float)value, (float)depthBuffer[index]))
+			return 0;
+		depthBuffer[index] = value;
+		return 1;
+	}
+	default:
+	{
+		float* depthBuffer = (float*)framebuffer->depth;
+		if (!compareDepth(framebuffer->depthCompare, depth, depthBuffer[index]))
+			return 0;
+		depthBuffer[index] = depth;
+		return 1;
+	}
+	}
+}
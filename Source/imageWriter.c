@@ -0,0 +1,444 @@
+#ifndef _WIN64
+#define _GNU_SOURCE // O_DIRECT
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "imageWriter.h"
+#include "thread.h"
+
+#ifndef _WIN64
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int imageWriteMode = WRITE_BUFFERED;
+
+static const char* imageExtensions[] = { ".png", ".rgb", ".ppm", ".qoi" };
+
+int getImageFormat(const char* filename)
+{
+	const char* extension = strrchr(filename, '.');
+	for (int format = IMAGE_RAW_RGB; extension && format <= IMAGE_QOI; format++)
+	{
+		if (strcmp(extension, imageExtensions[format]) == 0)
+			return format;
+	}
+	return IMAGE_PNG;
+}
+
+// the format named by its extension without the dot, -1 for an unknown name
+int getImageFormatByName(const char* name)
+{
+	for (int format = IMAGE_PNG; format <= IMAGE_QOI; format++)
+	{
+		if (strcmp(name, imageExtensions[format] + 1) == 0)
+			return format;
+	}
+	return -1;
+}
+
+const char* getImageExtension(int format)
+{
+	return imageExtensions[format >= IMAGE_PNG && format <= IMAGE_QOI ? format : IMAGE_PNG];
+}
+
+void setImageWriteMode(int mode)
+{
+	imageWriteMode = mode;
+}
+
+// Raw RGB rows, gray for one or two channels. PPM puts its header in front.
+static unsigned char* encodeRaw(const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int hasHeader, int* size)
+{
+	int channels = comp >= 3 ? 3 : 1;
+	char header[64];
+	int headerSize = hasHeader ? snprintf(header, sizeof(header), "P%d\n%d %d\n255\n", channels == 3 ? 6 : 5, width, height) : 0;
+	size_t rowSize = (size_t)width * channels;
+	unsigned char* image = malloc(headerSize + rowSize * height);
+	if (!image)
+		return NULL;
+
+	memcpy(image, header, headerSize);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* source = data + (size_t)stride * (isFlipped ? height - 1 - y : y);
+		unsigned char* destination = image + headerSize + rowSize * y;
+		if (comp == channels)
+		{
+			memcpy(destination, source, rowSize);
+			continue;
+		}
+		for (int x = 0; x < width; x++)
+			memcpy(&destination[x * channels], &source[x * comp], channels);
+	}
+	*size = (int)(headerSize + rowSize * height);
+	return image;
+}
+
+// "Quite OK Image" format, lossless and an order of magnitude faster than PNG.
+// RGB and RGBA only, see qoiformat.org for the specification.
+static unsigned char* encodeQOI(const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int* size)
+{
+	if (comp < 3)
+		return NULL;
+	unsigned char* image = malloc((size_t)width * height * (comp + 1) + 14 + 8);
+	if (!image)
+		return NULL;
+
+	unsigned char* output = image;
+	memcpy(output, "qoif", 4);
+	unsigned int header[2] = { (unsigned int)width, (unsigned int)height };
+	for (int i = 0; i < 2; i++)
+	{
+		output[4 + i * 4] = (unsigned char)(header[i] >> 24);
+		output[5 + i * 4] = (unsigned char)(header[i] >> 16);
+		output[6 + i * 4] = (unsigned char)(header[i] >> 8);
+		output[7 + i * 4] = (unsigned char)header[i];
+	}
+	output[12] = (unsigned char)comp;
+	output[13] = 0; // sRGB with linear alpha
+	output += 14;
+
+	unsigned char index[64][4];
+	memset(index, 0, sizeof(index));
+	unsigned char previous[4] = { 0, 0, 0, 255 };
+	unsigned char pixel[4] = { 0, 0, 0, 255 };
+	int run = 0;
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* row = data + (size_t)stride * (isFlipped ? height - 1 - y : y);
+		for (int x = 0; x < width; x++)
+		{
+			memcpy(pixel, &row[x * comp], comp);
+			if (memcmp(pixel, previous, 4) == 0)
+			{
+				run++;
+				if (run == 62)
+				{
+					*output++ = (unsigned char)(0xC0 | (run - 1));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				*output++ = (unsigned char)(0xC0 | (run - 1));
+				run = 0;
+			}
+
+			int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+			if (memcmp(index[hash], pixel, 4) == 0)
+				*output++ = (unsigned char)hash;
+			else if (pixel[3] == previous[3])
+			{
+				signed char dr = (signed char)(pixel[0] - previous[0]);
+				signed char dg = (signed char)(pixel[1] - previous[1]);
+				signed char db = (signed char)(pixel[2] - previous[2]);
+				signed char drg = (signed char)(dr - dg);
+				signed char dbg = (signed char)(db - dg);
+				if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+					*output++ = (unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+				else if (drg >= -8 && drg <= 7 && dg >= -32 && dg <= 31 && dbg >= -8 && dbg <= 7)
+				{
+					*output++ = (unsigned char)(0x80 | (dg + 32));
+					*output++ = (unsigned char)((drg + 8) << 4 | (dbg + 8));
+				}
+				else
+				{
+					*output++ = 0xFE;
+					memcpy(output, pixel, 3);
+					output += 3;
+				}
+			}
+			else
+			{
+				*output++ = 0xFF;
+				memcpy(output, pixel, 4);
+				output += 4;
+			}
+			memcpy(index[hash], pixel, 4);
+			memcpy(previous, pixel, 4);
+		}
+	}
+	if (run > 0)
+		*output++ = (unsigned char)(0xC0 | (run - 1));
+
+	static const unsigned char end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	memcpy(output, end, sizeof(end));
+	output += sizeof(end);
+	*size = (int)(output - image);
+	return image;
+}
+
+unsigned char* encodeImage(int format, const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int* size)
+{
+	if (stride == 0)
+		stride = width * comp;
+	switch (format)
+	{
+	case IMAGE_RAW_RGB:
+		return encodeRaw(data, width, height, comp, stride, isFlipped, 0, size);
+	case IMAGE_PPM:
+		return encodeRaw(data, width, height, comp, stride, isFlipped, 1, size);
+	case IMAGE_QOI:
+		return encodeQOI(data, width, height, comp, stride, isFlipped, size);
+	default:
+		return encodePNG(data, width, height, comp, stride, isFlipped, size);
+	}
+}
+
+static int writeFileBuffered(const char* filename, const void* data, size_t size)
+{
+	FILE* file = fopen(filename, "wb");
+	if (!file)
+		return 0;
+	setvbuf(file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+	size_t written = fwrite(data, 1, size, file);
+	return fclose(file) == 0 && written == size;
+}
+
+#ifdef O_DIRECT
+// O_DIRECT needs aligned buffers and sizes, the data goes through an aligned
+// buffer and the padding of the last block is cut off afterwards.
+static int writeFileDirect(const char* filename, const void* data, size_t size)
+{
+	int file = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+	if (file < 0)
+		return writeFileBuffered(filename, data, size); // file systems without O_DIRECT support
+
+	unsigned char* buffer = NULL;
+	int isWritten = posix_memalign((void**)&buffer, DIRECT_IO_ALIGNMENT, OUTPUT_BUFFER_SIZE) == 0;
+	for (size_t offset = 0; offset < size && isWritten; )
+	{
+		size_t count = MIN(size - offset, OUTPUT_BUFFER_SIZE);
+		size_t alignedCount = (count + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+		memcpy(buffer, (const unsigned char*)data + offset, count);
+		memset(buffer + count, 0, alignedCount - count);
+		isWritten = write(file, buffer, alignedCount) == (ssize_t)alignedCount;
+		offset += count;
+	}
+	isWritten = isWritten && ftruncate(file, size) == 0;
+	free(buffer);
+	return close(file) == 0 && isWritten;
+}
+#endif
+
+int writeFile(const char* filename, const void* data, size_t size)
+{
+#ifdef O_DIRECT
+	if (imageWriteMode == WRITE_DIRECT)
+		return writeFileDirect(filename, data, size);
+#endif
+	return writeFileBuffered(filename, data, size);
+}
+
+void writeImage(const char* filename, int width, int height, int comp,
+	const void* data, int stride, unsigned int isFlipped)
+{
+	int size;
+	unsigned char* image = encodeImage(getImageFormat(filename), data, width, height, comp, stride, isFlipped, &size);
+	if (!image)
+		return;
+	if (!writeFile(filename, image, size))
+		fprintf(stderr, "\nfailed to write %s\n", filename);
+	free(image);
+}
+
+typedef struct
+{
+	ImageWriter* writer;
+	Framebuffer* framebuffer;
+	char filename[MAX_OUTPUT_FILENAME];
+	unsigned int isFlipped;
+	int frameNumber;
+	int isBusy;
+	unsigned char* videoFrame; // only allocated when streaming video
+	unsigned char* rgb; // RGB copy of an RGBA8 color buffer, images are written without alpha
+}outputFrame;
+
+struct ImageWriter
+{
+	ThreadPool* pool;
+	Mutex* mutex;
+	Condition* condition;
+	outputFrame* frames;
+	int numOfFrames;
+	int nextFrame; // ring position of the next framebuffer to render into
+	int numOfSubmittedFrames;
+	int numOfWrittenFrames;
+	VideoStream* stream;
+};
+
+// Frames are encoded in parallel but written in submission order,
+// so a later frame never gets overwritten by an earlier one.
+static void encodeFrame(void* arg)
+{
+	outputFrame* frame = (outputFrame*)arg;
+	ImageWriter* writer = frame->writer;
+	Framebuffer* framebuffer = frame->framebuffer;
+
+	int size = 0;
+	unsigned char* image = NULL;
+	int isEncoded;
+	if (writer->stream)
+		isEncoded = encodeVideoFrame(writer->stream, framebuffer->color, framebuffer->bytesPerPixel,
+			framebuffer->stride, frame->isFlipped, frame->videoFrame);
+	else
+	{
+		const unsigned char* pixels = framebuffer->color;
+		int comp = framebuffer->bytesPerPixel;
+		int stride = framebuffer->stride;
+		if (frame->rgb)
+		{
+			readFramebufferRGB(framebuffer, frame->rgb, framebuffer->width * 3);
+			pixels = frame->rgb;
+			comp = 3;
+			stride = framebuffer->width * 3;
+		}
+		image = encodeImage(getImageFormat(frame->filename), pixels, framebuffer->width,
+			framebuffer->height, comp, stride, frame->isFlipped, &size);
+		isEncoded = image != NULL;
+	}
+
+	lockMutex(writer->mutex);
+	while (writer->numOfWrittenFrames != frame->frameNumber)
+		waitCondition(writer->condition, writer->mutex);
+	unlockMutex(writer->mutex);
+
+	if (writer->stream)
+	{
+		if (isEncoded)
+			writeVideoFrame(writer->stream, frame->videoFrame);
+	}
+	else if (!isEncoded || !writeFile(frame->filename, image, size))
+		fprintf(stderr, "\nfailed to write %s\n", frame->filename);
+	free(image);
+
+	lockMutex(writer->mutex);
+	writer->numOfWrittenFrames++;
+	frame->isBusy = 0;
+	broadcastCondition(writer->condition);
+	unlockMutex(writer->mutex);
+}
+
+// numOfThreads < 1 uses one encoder thread less than the number of framebuffers
+ImageWriter* createImageWriter(Framebuffer* framebuffers, int numOfFramebuffers, int numOfThreads)
+{
+	if (numOfFramebuffers < 1)
+		return NULL;
+	if (numOfThreads < 1)
+		numOfThreads = MAX(1, numOfFramebuffers - 1);
+
+	ImageWriter* writer = calloc(1, sizeof(ImageWriter));
+	if (!writer)
+		return NULL;
+	writer->frames = calloc(numOfFramebuffers, sizeof(outputFrame));
+	writer->mutex = createMutex();
+	writer->condition = createCondition();
+	writer->pool = createThreadPool(numOfThreads);
+	if (!writer->frames || !writer->mutex || !writer->condition || !writer->pool)
+	{
+		destroyImageWriter(writer);
+		return NULL;
+	}
+
+	writer->numOfFrames = numOfFramebuffers;
+	for (int i = 0; i < numOfFramebuffers; i++)
+	{
+		writer->frames[i].writer = writer;
+		writer->frames[i].framebuffer = &framebuffers[i];
+		if (framebuffers[i].bytesPerPixel == 3)
+			continue;
+		writer->frames[i].rgb = malloc((size_t)framebuffers[i].width * framebuffers[i].height * 3);
+		if (!writer->frames[i].rgb)
+		{
+			destroyImageWriter(writer);
+			return NULL;
+		}
+	}
+	return writer;
+}
+
+// Frames are streamed as video instead of written to image files, the stream
+// is set before the first frame is submitted and stays open until the writer is destroyed.
+int setImageWriterStream(ImageWriter* writer, VideoStream* stream)
+{
+	flushImageWriter(writer);
+	for (int i = 0; i < writer->numOfFrames; i++)
+	{
+		free(writer->frames[i].videoFrame);
+		writer->frames[i].videoFrame = stream ? malloc(getVideoFrameSize(stream)) : NULL;
+		if (stream && !writer->frames[i].videoFrame)
+		{
+			writer->stream = NULL;
+			return 0;
+		}
+	}
+	writer->stream = stream;
+	return 1;
+}
+
+// next framebuffer of the ring, blocks while its previous frame is not written yet
+Framebuffer* acquireOutputFramebuffer(ImageWriter* writer)
+{
+	outputFrame* frame = &writer->frames[writer->nextFrame];
+	writer->nextFrame = (writer->nextFrame + 1) % writer->numOfFrames;
+
+	lockMutex(writer->mutex);
+	while (frame->isBusy)
+		waitCondition(writer->condition, writer->mutex);
+	unlockMutex(writer->mutex);
+	return frame->framebuffer;
+}
+
+// The color buffer of the framebuffer has to be resolved. It must not be
+// drawn into until it is returned by acquireOutputFramebuffer again.
+void submitOutputFramebuffer(ImageWriter* writer, Framebuffer* framebuffer,
+	const char* filename, unsigned int isFlipped)
+{
+	outputFrame* frame = NULL;
+	for (int i = 0; i < writer->numOfFrames && !frame; i++)
+	{
+		if (writer->frames[i].framebuffer == framebuffer)
+			frame = &writer->frames[i];
+	}
+	if (!frame)
+		return;
+
+	snprintf(frame->filename, MAX_OUTPUT_FILENAME, "%s", filename ? filename : "");
+	frame->isFlipped = isFlipped;
+	frame->frameNumber = writer->numOfSubmittedFrames++;
+	lockMutex(writer->mutex);
+	frame->isBusy = 1;
+	unlockMutex(writer->mutex);
+	submitJob(writer->pool, encodeFrame, frame);
+}
+
+// waits until every submitted frame is written
+void flushImageWriter(ImageWriter* writer)
+{
+	waitThreadPool(writer->pool);
+}
+
+void destroyImageWriter(ImageWriter* writer)
+{
+	if (!writer)
+		return;
+	if (writer->pool)
+		destroyThreadPool(writer->pool);
+	if (writer->condition)
+		destroyCondition(writer->condition);
+	if (writer->mutex)
+		destroyMutex(writer->mutex);
+	for (int i = 0; writer->frames && i < writer->numOfFrames; i++)
+	{
+		free(writer->frames[i].videoFrame);
+		free(writer->frames[i].rgb);
+	}
+	free(writer->frames);
+	free(writer);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "framebuffer.h"
+#include "pngWriter.h"
+#include "videoStream.h"
+
+#define OUTPUT_RING_SIZE (3) // one framebuffer is rendered while the others are encoded
+#define MAX_OUTPUT_FILENAME (260)
+#define OUTPUT_BUFFER_SIZE (4 * 1024 * 1024)
+#define DIRECT_IO_ALIGNMENT (4096)
+
+// IMAGE_RAW_RGB, IMAGE_PPM and IMAGE_QOI skip the PNG compression for fast frame dumps.
+// Raw RGB is the bare pixel rows, PPM is the same with a header.
+enum imageFormat { IMAGE_PNG = 0, IMAGE_RAW_RGB = 1, IMAGE_PPM = 2, IMAGE_QOI = 3 };
+// WRITE_DIRECT bypasses the page cache with O_DIRECT where it is supported
+enum imageWriteMode { WRITE_BUFFERED = 0, WRITE_DIRECT = 1 };
+
+int getImageFormat(const char* filename);
+int getImageFormatByName(const char* name);
+const char* getImageExtension(int format);
+void setImageWriteMode(int mode);
+// the encoded image is released with free
+unsigned char* encodeImage(int format, const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int* size);
+int writeFile(const char* filename, const void* data, size_t size);
+// the format is chosen by the extension of the filename
+void writeImage(const char* filename, int width, int height, int comp,
+	const void* data, int stride, unsigned int isFlipped);
+
+// Output queue, finished frames are encoded and written by background threads in the
+// format of the filename. Images are written as RGB, an RGBA8 color buffer is converted
+// into a buffer of its ring slot first. The framebuffers form a ring, a framebuffer is
+// handed out for rendering again once its frame is written.
+typedef struct ImageWriter ImageWriter;
+
+ImageWriter* createImageWriter(Framebuffer* framebuffers, int numOfFramebuffers, int numOfThreads);
+Framebuffer* acquireOutputFramebuffer(ImageWriter* writer);
+int setImageWriterStream(ImageWriter* writer, VideoStream* stream);
+// filename is ignored while a video stream is set
+void submitOutputFramebuffer(ImageWriter* writer, Framebuffer* framebuffer,
+	const char* filename, unsigned int isFlipped);
+void flushImageWriter(ImageWriter* writer);
+void destroyImageWriter(ImageWriter* writer);
@@ -1,52 +1,48 @@
 #include <memory.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <float.h>
 #include <limits.h>
 #include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "tinyobj_loader_c.h"
-
-#ifdef _WIN64
-#define atoll(S) _atoi64(S)
-#include <windows.h>
-#include<memoryapi.h>
 #include "loader.h"
-#else
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <unistd.h>
-#endif
-
-extern vec3* vertexArray;
-extern vec3* normalArray;
-extern vec2* textureArray;
-
-typedef struct {
-	unsigned int vb;
-	int numTriangles;
-} DrawObject;
-
-static DrawObject gDrawObject;
+#include "mappedFile.h"
 
-static bool use_colors = false;
-static bool draw_wireframe = true;
+vec3* vertexArray;
+vec3* normalArray;
+vec2* textureArray;
+vec3* tangentArray;
 
-static const size_t OBJ_SIZE = sizeof(float) * 3 // pos
-+ sizeof(float) * 3 // normal
-+ sizeof(float) * 3 // color (based on normal)
-+ sizeof(float) * 3; // color from material file.
+// the OBJ is read in blocks of this size while it is streamed into a mesh file
+#ifndef MESH_STREAM_BLOCK_SIZE
+#define MESH_STREAM_BLOCK_SIZE (8 * 1024 * 1024)
+#endif
+// vertices, normals, texture coords and tangents
+#define MESH_STREAM_COUNT (4)
 
-static float prevMouseX, prevMouseY;
-static int mouseLeftPressed;
-static int mouseMiddlePressed;
-static int mouseRightPressed;
-static float curr_quat[4];
-static float prev_quat[4];
-static float eye[3], lookat[3], up[3];
+// the streams are stored de-indexed, 3 vertices per triangle, each starting on a 16 byte boundary
+typedef struct
+{
+	char magic[4];
+	int version;
+	unsigned long long numOfTriangles;
+	long long sourceSize;
+	long long sourceTime;
+	unsigned long long vertexOffset;
+	unsigned long long normalOffset;
+	unsigned long long textureOffset;
+	unsigned long long tangentOffset;
+}MeshFileHeader;
+
+// set while the streams point into a mapped mesh file
+static void* meshFile;
+static size_t meshFileSize;
 
 static void CalcNormal(float N[3], float v0[3], float v1[3], float v2[3]) {
 	float v10[3];
@@ -71,331 +67,383 @@ static void CalcNormal(float N[3], float v0[3], float v1[3], float v2[3]) {
 
 		N[0] /= len;
 		N[1] /= len;
+		N[2] /= len;
 	}
 }
 
-static char* mmap_file(size_t* len, const char* filename) {
-#ifdef _WIN64
-	HANDLE file =
-		CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
-			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+// the OBJ and its material file stay mapped until parsing is done, tinyobj keeps pointers into them
+typedef struct
+{
+	void* data[2];
+	size_t size[2];
+}objFileData;
 
-	if (file == INVALID_HANDLE_VALUE) { /* E.g. Model may not have materials. */
-		return NULL;
-	}
+static void get_file_data(void* ctx, const char* filename, const int is_mtl,
+	const char* obj_filename, char** data, size_t* len) {
+	objFileData* fileData = (objFileData*)ctx;
+	(void)obj_filename;
 
-	HANDLE fileMapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	(*data) = NULL;
+	(*len) = 0;
+	if (!filename || fileData->data[is_mtl]) {
+		return;
+	}
 
-	LPVOID fileMapView = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
-	char* fileMapViewChar = (char*)fileMapView;
+	size_t data_len = 0;
+	fileData->data[is_mtl] = mapFile(filename, &data_len);
+	fileData->size[is_mtl] = data_len;
+	(*data) = (char*)fileData->data[is_mtl];
+	(*len) = fileData->data[is_mtl] ? data_len : 0;
+}
 
-	DWORD file_size = GetFileSize(file, NULL);
-	(*len) = (size_t)file_size;
+static void releaseObjFileData(objFileData* fileData)
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (fileData->data[i])
+			unmapFile(fileData->data[i], fileData->size[i]);
+	}
+}
 
-	return fileMapViewChar;
-#else
+// one tangent per triangle, from the edges and the texture coord deltas
+static void calculateTangent(vec3 v[3], vec2 t[3], vec3 tangent)
+{
+	vec3 edge1, edge2;
+	vec2 deltaUV1, deltaUV2;
+	glm_vec3_sub(v[2], v[0], edge1);
+	glm_vec3_sub(v[1], v[0], edge2);
+	glm_vec2_sub(t[2], t[0], deltaUV1);
+	glm_vec2_sub(t[1], t[0], deltaUV2);
+	float f = 1.0f / (deltaUV1[0] * deltaUV2[1] - deltaUV2[0] * deltaUV1[1]);
+	tangent[0] = f * (deltaUV2[1] * edge1[0] - deltaUV1[1] * edge2[0]);
+	tangent[1] = f * (deltaUV2[1] * edge1[1] - deltaUV1[1] * edge2[1]);
+	tangent[2] = f * (deltaUV2[1] * edge1[2] - deltaUV1[1] * edge2[2]);
+}
 
-	struct stat sb;
-	char* p;
-	int fd;
+// Fills one triangle of the streams from its indices into the attributes.
+// Returns 0 when a vertex index is outside of the attributes.
+static int convertTriangle(const tinyobj_attrib_t* attrib, const tinyobj_vertex_index_t idx[3],
+	vec3 v[3], vec3 n[3], vec2 t[3], vec3 tangent)
+{
+	for (int k = 0; k < 3; k++)
+	{
+		if (idx[k].v_idx < 0 || (unsigned int)idx[k].v_idx >= attrib->num_vertices)
+			return 0;
+		memcpy(v[k], &attrib->vertices[3 * (size_t)idx[k].v_idx], sizeof(vec3));
+	}
 
-	fd = open(filename, O_RDONLY);
-	if (fd == -1) {
-		perror("open");
-		return NULL;
+	int hasTexcoords = 1;
+	int hasNormals = 1;
+	for (int k = 0; k < 3; k++)
+	{
+		hasTexcoords &= idx[k].vt_idx >= 0 && (unsigned int)idx[k].vt_idx < attrib->num_texcoords;
+		hasNormals &= idx[k].vn_idx >= 0 && (unsigned int)idx[k].vn_idx < attrib->num_normals;
 	}
 
-	if (fstat(fd, &sb) == -1) {
-		perror("fstat");
-		return NULL;
+	if (hasTexcoords)
+	{
+		for (int k = 0; k < 3; k++)
+			memcpy(t[k], &attrib->texcoords[2 * (size_t)idx[k].vt_idx], sizeof(vec2));
 	}
+	else
+		memset(t, 0, 3 * sizeof(vec2));
 
-	if (!S_ISREG(sb.st_mode)) {
-		fprintf(stderr, "%s is not a file\n", filename);
-		return NULL;
+	if (hasNormals)
+	{
+		for (int k = 0; k < 3; k++)
+			memcpy(n[k], &attrib->normals[3 * (size_t)idx[k].vn_idx], sizeof(vec3));
+	}
+	else
+	{
+		// normal index is not defined for this face, use the geometric normal
+		CalcNormal(n[0], v[0], v[1], v[2]);
+		glm_vec3_copy(n[0], n[1]);
+		glm_vec3_copy(n[0], n[2]);
 	}
 
-	p = (char*)mmap(0, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	calculateTangent(v, t, tangent);
+	return 1;
+}
+
+// Fills the renderer's streams in memory straight from the parsed attributes, 3 vertices per triangle.
+// Materials are not used by the renderer and are released right after parsing.
+static size_t convertObjFile(const char* filename)
+{
+	tinyobj_attrib_t attrib;
+	tinyobj_shape_t* shapes = NULL;
+	size_t num_shapes;
+	tinyobj_material_t* materials = NULL;
+	size_t num_materials;
+	objFileData fileData = { 0 };
+
+	unsigned int flags = TINYOBJ_FLAG_TRIANGULATE;
+	int ret = tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
+		&num_materials, filename, get_file_data, &fileData, flags);
+	releaseObjFileData(&fileData);
+	if (ret != TINYOBJ_SUCCESS)
+		return 0;
+	tinyobj_shapes_free(shapes, num_shapes);
+	tinyobj_materials_free(materials, num_materials);
 
-	if (p == MAP_FAILED) {
-		perror("mmap");
-		return NULL;
+	// every face is a triangle after triangulation
+	size_t numOfTriangles = attrib.num_face_num_verts;
+	vertexArray = (vec3*)malloc(numOfTriangles * 3 * sizeof(vec3));
+	normalArray = (vec3*)malloc(numOfTriangles * 3 * sizeof(vec3));
+	textureArray = (vec2*)malloc(numOfTriangles * 3 * sizeof(vec2));
+	tangentArray = (vec3*)malloc(numOfTriangles * sizeof(vec3));
+	int isConverted = vertexArray && normalArray && textureArray && tangentArray;
+	for (size_t i = 0; isConverted && i < numOfTriangles; i++)
+	{
+		isConverted = convertTriangle(&attrib, &attrib.faces[i * 3], &vertexArray[i * 3],
+			&normalArray[i * 3], &textureArray[i * 3], tangentArray[i]);
 	}
 
-	if (close(fd) == -1) {
-		perror("close");
-		return NULL;
+	tinyobj_attrib_free(&attrib);
+	if (!isConverted)
+	{
+		releaseMesh();
+		return 0;
 	}
+	return numOfTriangles;
+}
 
-	(*len) = sb.st_size;
-
-	return p;
+static unsigned long long alignMeshOffset(unsigned long long offset)
+{
+	return (offset + 15) & ~15ull;
+}
 
+static int seekMeshFile(FILE* file, unsigned long long offset)
+{
+#ifdef _WIN64
+	return _fseeki64(file, (long long)offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET);
 #endif
 }
 
-/* path will be modified */
-static char* get_dirname(char* path) {
-	char* last_delim = NULL;
-
-	if (path == NULL) {
-		return path;
+// An OBJ being converted block by block. The attributes are kept since faces can index
+// any earlier attribute, the triangles of every block are appended to the stream files
+// right away, so memory stays bounded by the attributes and one block.
+typedef struct
+{
+	FILE* streams[MESH_STREAM_COUNT];
+	unsigned long long numOfTriangles;
+	tinyobj_attrib_t attributes;
+	size_t vertexCapacity;
+	size_t normalCapacity;
+	size_t texcoordCapacity;
+}meshStream;
+
+// bytes per triangle of every stream, in file order
+static const size_t meshStreamStrides[MESH_STREAM_COUNT] = {
+	3 * sizeof(vec3), 3 * sizeof(vec3), 3 * sizeof(vec2), sizeof(vec3) };
+
+static int appendAttributes(float** attributes, unsigned int* count, size_t* capacity,
+	const float* block, size_t offset, size_t blockCount, int components)
+{
+	if (offset + blockCount > *capacity)
+	{
+		size_t grownCapacity = MAX(*capacity * 2, offset + blockCount);
+		float* grown = (float*)realloc(*attributes, grownCapacity * components * sizeof(float));
+		if (!grown)
+			return 0;
+		*attributes = grown;
+		*capacity = grownCapacity;
 	}
+	memcpy(*attributes + offset * components, block, blockCount * components * sizeof(float));
+	*count = (unsigned int)(offset + blockCount);
+	return 1;
+}
 
-#if defined(_WIN32)
-	/* TODO: Unix style path */
-	last_delim = strrchr(path, '\\');
-#else
-	last_delim = strrchr(path, '/');
-#endif
-
-	if (last_delim == NULL) {
-		/* no delimiter in the string. */
-		return path;
+static int appendMeshBlock(void* ctx, const tinyobj_attrib_t* block, size_t vertexOffset,
+	size_t normalOffset, size_t texcoordOffset)
+{
+	meshStream* stream = (meshStream*)ctx;
+	tinyobj_attrib_t* attributes = &stream->attributes;
+	if (!appendAttributes(&attributes->vertices, &attributes->num_vertices, &stream->vertexCapacity,
+			block->vertices, vertexOffset, block->num_vertices, 3) ||
+		!appendAttributes(&attributes->normals, &attributes->num_normals, &stream->normalCapacity,
+			block->normals, normalOffset, block->num_normals, 3) ||
+		!appendAttributes(&attributes->texcoords, &attributes->num_texcoords, &stream->texcoordCapacity,
+			block->texcoords, texcoordOffset, block->num_texcoords, 2))
+		return 1;
+
+	size_t numOfTriangles = block->num_face_num_verts;
+	if (numOfTriangles == 0)
+		return 0;
+
+	vec3* vertices = (vec3*)malloc(numOfTriangles * meshStreamStrides[0]);
+	vec3* normals = (vec3*)malloc(numOfTriangles * meshStreamStrides[1]);
+	vec2* texcoords = (vec2*)malloc(numOfTriangles * meshStreamStrides[2]);
+	vec3* tangents = (vec3*)malloc(numOfTriangles * meshStreamStrides[3]);
+	int isConverted = vertices && normals && texcoords && tangents;
+	for (size_t i = 0; isConverted && i < numOfTriangles; i++)
+	{
+		isConverted = convertTriangle(attributes, &block->faces[i * 3], &vertices[i * 3],
+			&normals[i * 3], &texcoords[i * 3], tangents[i]);
 	}
 
-	/* remove '/' */
-	last_delim[0] = '\0';
+	const void* cluster[MESH_STREAM_COUNT] = { vertices, normals, texcoords, tangents };
+	for (int i = 0; isConverted && i < MESH_STREAM_COUNT; i++)
+		isConverted = fwrite(cluster[i], numOfTriangles * meshStreamStrides[i], 1, stream->streams[i]) == 1;
+	stream->numOfTriangles += numOfTriangles;
 
-	return path;
+	free(vertices);
+	free(normals);
+	free(texcoords);
+	free(tangents);
+	return !isConverted;
 }
 
-static void get_file_data(void* ctx, const char* filename, const int is_mtl,
-	const char* obj_filename, char** data, size_t* len) {
-	// NOTE: If you allocate the buffer with malloc(),
-	// You can define your own memory management struct and pass it through `ctx`
-	// to store the pointer and free memories at clean up stage(when you quit an
-	// app)
-	// This example uses mmap(), so no free() required.
-	(void)ctx;
-
-	if (!filename) {
-		//printf("null filename\n");
-		(*data) = NULL;
-		(*len) = 0;
-		return;
+// appends a whole temporary stream file to the mesh file in bounded pieces
+static int copyMeshStream(FILE* from, FILE* to)
+{
+	char buffer[64 * 1024];
+	size_t size;
+	rewind(from);
+	while ((size = fread(buffer, 1, sizeof(buffer), from)) > 0)
+	{
+		if (fwrite(buffer, size, 1, to) != 1)
+			return 0;
 	}
+	return !ferror(from);
+}
 
-	size_t data_len = 0;
+// Streams the OBJ into the mesh file without holding the OBJ or the whole mesh in memory.
+// The mesh file is assembled under a temporary name and moved over the cache when it is
+// complete. The vertex stream is written into it directly, the other streams go to
+// temporary files first since their offsets are known only after the last block.
+static size_t streamObjToMeshFile(const char* filename, const char* filePath, struct stat* sourceStat)
+{
+	meshStream stream = { 0 };
+	MeshFileHeader header = { 0 };
+	header.vertexOffset = alignMeshOffset(sizeof(header));
+
+	// other renderers may have the current file mapped, it is replaced and never rewritten
+	char tempFilePath[1024];
+	FILE* file = createReplacementFile(filePath, tempFilePath, sizeof(tempFilePath));
+	if (!file)
+		return 0;
+	stream.streams[0] = file;
+	int isWritten = seekMeshFile(file, header.vertexOffset) == 0;
+	for (int i = 1; i < MESH_STREAM_COUNT; i++)
+	{
+		stream.streams[i] = tmpfile();
+		isWritten &= stream.streams[i] != NULL;
+	}
 
-	*data = mmap_file(&data_len, filename);
-	(*len) = data_len;
+	isWritten = isWritten && tinyobj_parse_obj_stream(filename, TINYOBJ_FLAG_TRIANGULATE,
+		MESH_STREAM_BLOCK_SIZE, appendMeshBlock, &stream) == TINYOBJ_SUCCESS && stream.numOfTriangles > 0;
+
+	memcpy(header.magic, MESH_FILE_MAGIC, 4);
+	header.version = MESH_FILE_VERSION;
+	header.numOfTriangles = stream.numOfTriangles;
+	header.sourceSize = (long long)sourceStat->st_size;
+	header.sourceTime = (long long)sourceStat->st_mtime;
+	header.normalOffset = alignMeshOffset(header.vertexOffset + stream.numOfTriangles * meshStreamStrides[0]);
+	header.textureOffset = alignMeshOffset(header.normalOffset + stream.numOfTriangles * meshStreamStrides[1]);
+	header.tangentOffset = alignMeshOffset(header.textureOffset + stream.numOfTriangles * meshStreamStrides[2]);
+
+	isWritten = isWritten &&
+		seekMeshFile(file, header.normalOffset) == 0 && copyMeshStream(stream.streams[1], file) &&
+		seekMeshFile(file, header.textureOffset) == 0 && copyMeshStream(stream.streams[2], file) &&
+		seekMeshFile(file, header.tangentOffset) == 0 && copyMeshStream(stream.streams[3], file) &&
+		seekMeshFile(file, 0) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+
+	for (int i = 1; i < MESH_STREAM_COUNT; i++)
+	{
+		if (stream.streams[i])
+			fclose(stream.streams[i]);
+	}
+	free(stream.attributes.vertices);
+	free(stream.attributes.normals);
+	free(stream.attributes.texcoords);
+	if (!commitReplacementFile(file, tempFilePath, filePath, isWritten))
+		return 0;
+	return (size_t)stream.numOfTriangles;
 }
 
-int LoadObjAndConvert(const char* filename) 
+// the streams are read as floats straight from the mapping, so they have to be aligned
+// and the sizes are compared without overflowing
+static int isMeshStreamInFile(unsigned long long offset, size_t numOfTriangles, size_t stride, size_t fileSize)
 {
-	tinyobj_attrib_t attrib;
-	tinyobj_shape_t* shapes = NULL;
-	size_t num_shapes;
-	tinyobj_material_t* materials = NULL;
-	size_t num_materials;
-	PointF p1, p2, p3;
+	return offset % sizeof(float) == 0 && offset <= fileSize &&
+		numOfTriangles <= (fileSize - (size_t)offset) / stride;
+}
 
+static size_t mapMeshFile(const char* filePath, struct stat* sourceStat)
+{
+	size_t fileSize = 0;
+	unsigned char* file = mapFile(filePath, &fileSize);
+	if (!file)
+		return 0;
+
+	MeshFileHeader* header = (MeshFileHeader*)file;
+	size_t numOfTriangles = fileSize >= sizeof(MeshFileHeader) ? (size_t)header->numOfTriangles : 0;
+	int isValid = numOfTriangles > 0 &&
+		memcmp(header->magic, MESH_FILE_MAGIC, 4) == 0 &&
+		header->version == MESH_FILE_VERSION &&
+		header->sourceSize == (long long)sourceStat->st_size &&
+		header->sourceTime == (long long)sourceStat->st_mtime &&
+		isMeshStreamInFile(header->vertexOffset, numOfTriangles, meshStreamStrides[0], fileSize) &&
+		isMeshStreamInFile(header->normalOffset, numOfTriangles, meshStreamStrides[1], fileSize) &&
+		isMeshStreamInFile(header->textureOffset, numOfTriangles, meshStreamStrides[2], fileSize) &&
+		isMeshStreamInFile(header->tangentOffset, numOfTriangles, meshStreamStrides[3], fileSize);
+	if (!isValid)
 	{
-		unsigned int flags = TINYOBJ_FLAG_TRIANGULATE;
-		int ret =
-			tinyobj_parse_obj(&attrib, &shapes, &num_shapes, &materials,
-				&num_materials, filename, get_file_data, NULL, flags);
-		if (ret != TINYOBJ_SUCCESS) 
-		{
-			return 0;
-		}
-
+		unmapFile(file, fileSize);
+		return 0;
 	}
 
-	vertexArray = (vec3*)malloc(attrib.num_face_num_verts * 3 * sizeof(vec3));
-	normalArray = (vec3*)malloc(attrib.num_face_num_verts * 3 * sizeof(vec3));
-	textureArray = (vec2*)malloc(attrib.num_face_num_verts * 3 * sizeof(vec2));
+	vertexArray = (vec3*)(file + header->vertexOffset);
+	normalArray = (vec3*)(file + header->normalOffset);
+	textureArray = (vec2*)(file + header->textureOffset);
+	tangentArray = (vec3*)(file + header->tangentOffset);
+	meshFile = file;
+	meshFileSize = fileSize;
+	return numOfTriangles;
+}
+
+// Maps the preprocessed mesh file when it is up to date, otherwise streams the OBJ into
+// a new mesh file and maps that. The mapped streams are paged in by the OS as the renderer
+// walks the triangles. Without a writable mesh file the OBJ is converted in memory.
+// Returns the number of triangles.
+int LoadObjAndConvert(const char* filename)
+{
+	char filePath[1024];
+	struct stat sourceStat;
+	if (stat(filename, &sourceStat) != 0)
+		return 0;
 
+	snprintf(filePath, sizeof(filePath), "%s%s", filename, MESH_FILE_EXTENSION);
+	size_t numOfTriangles = mapMeshFile(filePath, &sourceStat);
+	if (numOfTriangles)
+		return (int)numOfTriangles;
+
+	if (streamObjToMeshFile(filename, filePath, &sourceStat))
 	{
-		DrawObject o;
-		float* vb;
-		/* std::vector<float> vb; //  */
-		size_t face_offset = 0;
-		size_t i;
-
-		/* Assume triangulated face. */
-		size_t num_triangles = attrib.num_face_num_verts;
-		size_t stride =
-			OBJ_SIZE /
-			sizeof(float);
-
-		vb = (float*)malloc(OBJ_SIZE * num_triangles * 3);
-
-		for (i = 0; i < attrib.num_face_num_verts; i++) 
-		{
-			size_t f;
-			for (f = 0; f < (size_t)attrib.face_num_verts[i] / 3; f++) 
-			{
-				size_t k;
-				float v[3][3];
-				float n[3][3];
-				float t[3][2];
-				float c[3];
-				float len2;
-
-				tinyobj_vertex_index_t idx0 = attrib.faces[face_offset + 3 * f + 0];
-				tinyobj_vertex_index_t idx1 = attrib.faces[face_offset + 3 * f + 1];
-				tinyobj_vertex_index_t idx2 = attrib.faces[face_offset + 3 * f + 2];
-
-				for (k = 0; k < 3; k++) 
-				{
-					int f0 = idx0.v_idx;
-					int f1 = idx1.v_idx;
-					int f2 = idx2.v_idx;
-
-					v[0][k] = attrib.vertices[3 * (size_t)f0 + k];
-					v[1][k] = attrib.vertices[3 * (size_t)f1 + k];
-					v[2][k] = attrib.vertices[3 * (size_t)f2 + k];
-				}
-
-				vertexArray[0 + i * 3][0] = v[0][0];
-				vertexArray[0 + i * 3][1] = v[0][1];
-				vertexArray[0 + i * 3][2] = v[0][2];
-
-				vertexArray[1 + i * 3][0] = v[1][0];
-				vertexArray[1 + i * 3][1] = v[1][1];
-				vertexArray[1 + i * 3][2] = v[1][2];
-
-				vertexArray[2 + i * 3][0] = v[2][0];
-				vertexArray[2 + i * 3][1] = v[2][1];
-				vertexArray[2 + i * 3][2] = v[2][2];
-
-				if (attrib.num_texcoords > 0)
-				{
-					int f0 = idx0.vt_idx;
-					int f1 = idx1.vt_idx;
-					int f2 = idx2.vt_idx;
-
-					for (k = 0; k < 2; k++)
-					{
-						t[0][k] = attrib.texcoords[2 * (size_t)f0 + k];
-						t[1][k] = attrib.texcoords[2 * (size_t)f1 + k];
-						t[2][k] = attrib.texcoords[2 * (size_t)f2 + k];
-					}
-				}
-				textureArray[0 + i * 3][0] = t[0][0];
-				textureArray[0 + i * 3][1] = t[0][1];
-
-				textureArray[1 + i * 3][0] = t[1][0];
-				textureArray[1 + i * 3][1] = t[1][1];
-
-				textureArray[2 + i * 3][0] = t[2][0];
-				textureArray[2 + i * 3][1] = t[2][1];
-					
-				if (attrib.num_normals > 0) 
-				{
-					int f0 = idx0.vn_idx;
-					int f1 = idx1.vn_idx;
-					int f2 = idx2.vn_idx;
-					if (f0 >= 0 && f1 >= 0 && f2 >= 0) 
-					{
-						for (k = 0; k < 3; k++) 
-						{
-							n[0][k] = attrib.normals[3 * (size_t)f0 + k];
-							n[1][k] = attrib.normals[3 * (size_t)f1 + k];
-							n[2][k] = attrib.normals[3 * (size_t)f2 + k];
-						}
-						normalArray[0 + i * 3][0] = n[0][0];
-						normalArray[0 + i * 3][1] = n[0][1];
-						normalArray[0 + i * 3][2] = n[0][2];
-
-						normalArray[1 + i * 3][0] = n[1][0];
-						normalArray[1 + i * 3][1] = n[1][1];
-						normalArray[1 + i * 3][2] = n[1][2];
-
-						normalArray[2 + i * 3][0] = n[2][0];
-						normalArray[2 + i * 3][1] = n[2][1];
-						normalArray[2 + i * 3][2] = n[2][2];
-					}
-					else 
-					{ /* normal index is not defined for this face */
-				      /* compute geometric normal */
-						CalcNormal(n[0], v[0], v[1], v[2]);
-						n[1][0] = n[0][0];
-						n[1][1] = n[0][1];
-						n[1][2] = n[0][2];
-						n[2][0] = n[0][0];
-						n[2][1] = n[0][1];
-						n[2][2] = n[0][2];
-					}
-				}
-				else 
-				{
-					/* compute geometric normal */
-					CalcNormal(n[0], v[0], v[1], v[2]);
-					n[1][0] = n[0][0];
-					n[1][1] = n[0][1];
-					n[1][2] = n[0][2];
-					n[2][0] = n[0][0];
-					n[2][1] = n[0][1];
-					n[2][2] = n[0][2];
-				}
-
-				for (k = 0; k < 3; k++) 
-				{
-					vb[(3 * i + k) * stride + 0] = v[k][0];
-					vb[(3 * i + k) * stride + 1] = v[k][1];
-					vb[(3 * i + k) * stride + 2] = v[k][2];
-					vb[(3 * i + k) * stride + 3] = n[k][0];
-					vb[(3 * i + k) * stride + 4] = n[k][1];
-					vb[(3 * i + k) * stride + 5] = n[k][2];
-
-					/* Set the normal as alternate color */
-					c[0] = n[k][0];
-					c[1] = n[k][1];
-					c[2] = n[k][2];
-					len2 = c[0] * c[0] + c[1] * c[1] + c[2] * c[2];
-					if (len2 > 0.0f) 
-					{
-						float len = (float)sqrt((double)len2);
-
-						c[0] /= len;
-						c[1] /= len;
-						c[2] /= len;
-					}
-
-					vb[(3 * i + k) * stride + 6] = (c[0] * 0.5f + 0.5f);
-					vb[(3 * i + k) * stride + 7] = (c[1] * 0.5f + 0.5f);
-					vb[(3 * i + k) * stride + 8] = (c[2] * 0.5f + 0.5f);
-
-					/* now set the color from the material */
-					if (attrib.material_ids[i] >= 0) 
-					{
-						int matidx = attrib.material_ids[i];
-						vb[(3 * i + k) * stride + 9] = materials[matidx].diffuse[0];
-						vb[(3 * i + k) * stride + 10] = materials[matidx].diffuse[1];
-						vb[(3 * i + k) * stride + 11] = materials[matidx].diffuse[2];
-					}
-					else 
-					{
-						/* Just copy the default value */
-						vb[(3 * i + k) * stride + 9] = vb[(3 * i + k) * stride + 6];
-						vb[(3 * i + k) * stride + 10] = vb[(3 * i + k) * stride + 7];
-						vb[(3 * i + k) * stride + 11] = vb[(3 * i + k) * stride + 8];
-					}
-
-				}
-			}
-			/* You can access per-face material through attrib.material_ids[i] */
-
-			face_offset += (size_t)attrib.face_num_verts[i];
-		}
-
-		o.vb = 0;
-		o.numTriangles = 0;
-		if (num_triangles > 0) 
-		{
-			return num_triangles;
-		}
-		free(vb);
-
-		gDrawObject = o;
+		numOfTriangles = mapMeshFile(filePath, &sourceStat);
+		if (numOfTriangles)
+			return (int)numOfTriangles;
 	}
 
-	tinyobj_attrib_free(&attrib);
-	tinyobj_shapes_free(shapes, num_shapes);
-	tinyobj_materials_free(materials, num_materials);
+	return (int)convertObjFile(filename);
+}
 
-	return 1;
+void releaseMesh()
+{
+	if (meshFile)
+		unmapFile(meshFile, meshFileSize);
+	else
+	{
+		free(vertexArray);
+		free(normalArray);
+		free(textureArray);
+		free(tangentArray);
+	}
+	meshFile = NULL;
+	vertexArray = NULL;
+	normalArray = NULL;
+	textureArray = NULL;
+	tangentArray = NULL;
 }
@@ -1,8 +1,15 @@
 #pragma once
 #include "commonTypes.h"
 
-vec3* vertexArray;
-vec3* normalArray;
-vec2* textureArray;
+// preprocessed, render-ready mesh files written next to the source OBJ
+#define MESH_FILE_MAGIC "RMSH"
+#define MESH_FILE_VERSION (1)
+#define MESH_FILE_EXTENSION ".rmesh"
+
+extern vec3* vertexArray;
+extern vec3* normalArray;
+extern vec2* textureArray;
+extern vec3* tangentArray; // one per triangle
 
 int LoadObjAndConvert(const char* filename);
+void releaseMesh();
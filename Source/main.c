@@ -1,63 +1,66 @@
+#ifdef TINY_RENDERER_VIEWER
 #include <glad/glad.h>
 #include <glfw-3.3.7/include/GLFW/glfw3.h>
+#endif
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "stb_image_write.h"
 #include "math.h"
 #include "swap.h"
 #include "loader.h"
 #include "commonTypes.h"
 #include "main.h"
+#ifdef TINY_RENDERER_VIEWER
 #include "Window.h"
+#endif
 #include "stb_image.h"
+#include "texture.h"
+#include "framebuffer.h"
+#include "imageWriter.h"
+#include "thread.h"
 
 //globals
-extern char* textureData; // output image, to pass it to the openGL side as texture
-int normalTextureWidth, normalTextureHeight, normalNumOfChannels;
-int textureWidth, textureHeight, numOfChannels;
+char* textureData; // output image, to pass it to the openGL side as texture
+int textureDataWidth;
+int textureDataHeight;
+int textureDataBytesPerPixel;
+int textureDataStride;
 mat4 modelMatrix, viewMatrix, projectionMatrix;
 mat3 TBN; //to change the spaces between world-tangent
 vec3 lightDir, viewDir, normal;
 
 enum triangleDrawingMode { FILLED = 1, MESH = 0 };
+// FORWARD_SHADING shades every fragment passing the depth test while drawing,
+// VISIBILITY_BUFFER_SHADING shades each visible pixel once after all triangles are drawn
+enum shadingMode { FORWARD_SHADING = 0, VISIBILITY_BUFFER_SHADING = 1 };
 
 
-void createColorBuffer(int width, int height, unsigned char** data)
+// clears only flag the tiles of the framebuffer, see touchFramebufferRegion
+void clearColor(int red, int green, int blue, Framebuffer* framebuffer)
 {
-	*data = calloc(NUMBER_OF_CHANNELS * width * height, sizeof(unsigned char));
+	framebuffer->clearColor[0] = red;
+	framebuffer->clearColor[1] = green;
+	framebuffer->clearColor[2] = blue;
+	framebuffer->clearColor[3] = 255;
+	clearFramebuffer(framebuffer, TILE_CLEAR_COLOR);
 }
 
-void createDepthBuffer(int width, int height, float** depthBuffer)
+void clearDepthBuffer(float zValue, Framebuffer* framebuffer)
 {
-	*depthBuffer = calloc(width * height, sizeof(float));
+	framebuffer->clearDepth = zValue;
+	clearFramebuffer(framebuffer, TILE_CLEAR_DEPTH);
 }
 
-void writeImage(const char* filename, int width, int height, int comp,
-	const void* data, int stride, unsigned int isFlipped)
+// with multisampling every sample of the pixel is written
+void setPixel(float red, float green, float blue, int x, int y, Framebuffer* framebuffer)
 {
-	stbi_flip_vertically_on_write(isFlipped);
-	stbi_write_png(filename, width, height, comp, data, stride);
+	setPixelSamples(red, green, blue, x, y, (1 << framebuffer->sampleCount) - 1, framebuffer);
 }
 
-void clearColor(int red, int green, int blue, unsigned char* data)
-{
-	for (unsigned int i = 0; i < RENDER_WIDTH * RENDER_HEIGHT; i++)
-	{
-		data[i * NUMBER_OF_CHANNELS] = red;
-		data[i * NUMBER_OF_CHANNELS + 1] = green;
-		data[i * NUMBER_OF_CHANNELS + 2] = blue;
-	}
-}
-
-void clearDepthBuffer(float zValue, float* depthBuffer)
-{
-	for (unsigned int i = 0; i < RENDER_WIDTH * RENDER_HEIGHT; i++)
-	{
-		depthBuffer[i] = zValue;
-	}
-}
-
-void setPixel(float red, float green, float blue, int x, int y, unsigned char* data)
+// writes the color to the samples of the pixel that are set in the coverage mask
+void setPixelSamples(float red, float green, float blue, int x, int y, int coverage, Framebuffer* framebuffer)
 {
 	if (red < 0.0)
 		red = 0;
@@ -70,15 +73,37 @@ void setPixel(float red, float green, float blue, int x, int y, unsigned char* d
 	green *= 255;
 	blue *= 255;
 
-	data[y * RENDER_WIDTH * NUMBER_OF_CHANNELS + x * NUMBER_OF_CHANNELS] = red;
-	data[y * RENDER_WIDTH * NUMBER_OF_CHANNELS + x * NUMBER_OF_CHANNELS + 1] = green;
-	data[y * RENDER_WIDTH * NUMBER_OF_CHANNELS + x * NUMBER_OF_CHANNELS + 2] = blue;
+	if (framebuffer->sampleCount > 1)
+	{
+		int bytesPerPixel = framebuffer->bytesPerPixel;
+		unsigned char rgba[4] = { red, green, blue, 255 };
+		unsigned char* samples = &framebuffer->sampleColor[
+			((size_t)y * framebuffer->width + x) * framebuffer->sampleCount * bytesPerPixel];
+		for (int s = 0; s < framebuffer->sampleCount; s++)
+		{
+			if (coverage & (1 << s))
+				memcpy(&samples[s * bytesPerPixel], rgba, bytesPerPixel);
+		}
+		return;
+	}
+
+	unsigned char* pixel = &framebuffer->color[y * framebuffer->stride + x * framebuffer->bytesPerPixel];
+	if (framebuffer->format == FORMAT_RGBA8)
+	{
+		// a single 32-bit store instead of three byte writes
+		unsigned char rgba[4] = { red, green, blue, 255 };
+		memcpy(pixel, rgba, 4);
+		return;
+	}
+	pixel[0] = red;
+	pixel[1] = green;
+	pixel[2] = blue;
 }
 
-void setViewPort(vec3 point, ivec2 screenPoint)
+void setViewPort(vec3 point, ivec2 screenPoint, Framebuffer* framebuffer)
 {
-	screenPoint[0] = (point[0] + 1.0f) * RENDER_WIDTH / 2;
-	screenPoint[1] = (point[1] + 1.0f) * RENDER_HEIGHT / 2;
+	screenPoint[0] = (point[0] + 1.0f) * framebuffer->width / 2;
+	screenPoint[1] = (point[1] + 1.0f) * framebuffer->height / 2;
 }
 
 int isInNDC(vec3 point)
@@ -89,13 +114,18 @@ int isInNDC(vec3 point)
 		return 0;
 }
 
-void drawLine(int red, int green, int blue, vec3 start, vec3 end, unsigned char* data)
+void drawLine(int red, int green, int blue, vec3 start, vec3 end, Framebuffer* framebuffer)
 {
 	if (isInNDC(start) && isInNDC(end))
 	{
 		ivec2 startInPixel, endInPixel;
-		setViewPort(start, &startInPixel);
-		setViewPort(end, &endInPixel);
+		setViewPort(start, &startInPixel, framebuffer);
+		setViewPort(end, &endInPixel, framebuffer);
+		// the point at NDC 1.0 maps to the pixel just outside the framebuffer
+		startInPixel[0] = MIN(startInPixel[0], framebuffer->width - 1);
+		startInPixel[1] = MIN(startInPixel[1], framebuffer->height - 1);
+		endInPixel[0] = MIN(endInPixel[0], framebuffer->width - 1);
+		endInPixel[1] = MIN(endInPixel[1], framebuffer->height - 1);
 
 		unsigned int steep = 0;
 		if (abs(startInPixel[0] - endInPixel[0]) < abs(startInPixel[1] - endInPixel[1]))
@@ -109,6 +139,13 @@ void drawLine(int red, int green, int blue, vec3 start, vec3 end, unsigned char*
 			swap(&startInPixel[0], &endInPixel[0]);
 			swap(&startInPixel[1], &endInPixel[1]);
 		}
+		if (steep)
+			touchFramebufferRegion(framebuffer, MIN(startInPixel[1], endInPixel[1]), startInPixel[0],
+				MAX(startInPixel[1], endInPixel[1]), endInPixel[0]);
+		else
+			touchFramebufferRegion(framebuffer, startInPixel[0], MIN(startInPixel[1], endInPixel[1]),
+				endInPixel[0], MAX(startInPixel[1], endInPixel[1]));
+
 		int dx = endInPixel[0] - startInPixel[0];
 		int dy = endInPixel[1] - startInPixel[1];
 		int derror2 = abs(dy) * 2;
@@ -118,11 +155,11 @@ void drawLine(int red, int green, int blue, vec3 start, vec3 end, unsigned char*
 		{
 			if (steep)
 			{
-				setPixel(red, green, blue, y, x, data);
+				setPixel(red, green, blue, y, x, framebuffer);
 			}
 			else
 			{
-				setPixel(red, green, blue, x, y, data);
+				setPixel(red, green, blue, x, y, framebuffer);
 			}
 			error2 += derror2;
 			if (error2 > dx)
@@ -134,20 +171,6 @@ void drawLine(int red, int green, int blue, vec3 start, vec3 end, unsigned char*
 	}
 }
 
-// gets barycentric texture coord and returns the color of the pixel([0,1]) 
-// that corresponds to the texture coord
-void getTextureColor(vec2 textCoord, int textureWidth, int textureHeight, int numOfChannels,
-	unsigned char* texture, float* r, float* g, float* b)
-{
-	ivec2 texturePixels;
-	texturePixels[0] = textCoord[0] * textureWidth;
-	texturePixels[1] = fabs(textCoord[1] - 1.0f) * textureHeight;
-
-	*r = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels]) / 255.0f;
-	*g = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels + 1]) / 255.0f;
-	*b = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels + 2]) / 255.0f;
-}
-
 // Function to check if three
 // points make a triangle
 bool checkTriangle(ivec2 p1, ivec2 p2, ivec2 p3)
@@ -198,96 +221,361 @@ void Barycentric(ivec2 p, ivec2 a, ivec2 b, ivec2 c, vec3 barycentricCoords)
 	}
 }
 
+// Texture coords are interpolated linearly in screen space, so their
+// derivatives along x and y are the gradients of the plane through the
+// three projected vertices.
+void calculateTextureCoordDerivatives(ivec2 p1, ivec2 p2, ivec2 p3,
+	vec2 textureCoord1, vec2 textureCoord2, vec2 textureCoord3, vec2 dTextureCoordDx, vec2 dTextureCoordDy)
+{
+	float e1x = p2[0] - p1[0], e1y = p2[1] - p1[1];
+	float e2x = p3[0] - p1[0], e2y = p3[1] - p1[1];
+	float area = e1x * e2y - e2x * e1y;
+	if (area == 0.0f)
+		return;
+
+	for (int i = 0; i < 2; i++)
+	{
+		float d1 = textureCoord2[i] - textureCoord1[i];
+		float d2 = textureCoord3[i] - textureCoord1[i];
+		dTextureCoordDx[i] = (d1 * e2y - d2 * e1y) / area;
+		dTextureCoordDy[i] = (d2 * e1x - d1 * e2x) / area;
+	}
+}
+
+// fragment shader: returns the lit color of the point with the given
+// barycentric coords on the triangle
+void shadeFragment(vertexBufferData* triangleData, vec3 bc_screen,
+	vec2 dTextureCoordDx, vec2 dTextureCoordDy,
+	Texture* texture, Texture* textureNormal, Sampler* sampler, vec3 color)
+{
+	vec3 bc_normalCoord, worldSpaceNormal;
+	vec2 bc_textureCoord;
+	float r, g, b;
+	float intensity;
+	vec3 lightDir = { 0.0, 0.0, 1.0f };
+	mat3 inverseTBN;
+
+	// texture sampler
+	bc_textureCoord[0] = triangleData->textureCoord1[0] * bc_screen[0] +
+		triangleData->textureCoord2[0] * bc_screen[1] +
+		triangleData->textureCoord3[0] * bc_screen[2];
+	bc_textureCoord[1] = triangleData->textureCoord1[1] * bc_screen[0] +
+		triangleData->textureCoord2[1] * bc_screen[1] +
+		triangleData->textureCoord3[1] * bc_screen[2];
+
+	//get color value of the pixel
+	sampleTexture(texture, sampler, bc_textureCoord,
+		dTextureCoordDx, dTextureCoordDy, &r, &g, &b);
+	getTextureNormal(bc_textureCoord, textureNormal->width, textureNormal->height,
+		textureNormal->data, normal);
+
+	//interpolate the normal vectors
+	bc_normalCoord[0] = triangleData->vertexNormal1[0] * bc_screen[0] +
+		triangleData->vertexNormal2[0] * bc_screen[1] +
+		triangleData->vertexNormal3[0] * bc_screen[2];
+	bc_normalCoord[1] = triangleData->vertexNormal1[1] * bc_screen[0] +
+		triangleData->vertexNormal2[1] * bc_screen[1] +
+		triangleData->vertexNormal3[1] * bc_screen[2];
+	bc_normalCoord[2] = triangleData->vertexNormal1[2] * bc_screen[0] +
+		triangleData->vertexNormal2[2] * bc_screen[1] +
+		triangleData->vertexNormal3[2] * bc_screen[2];
+
+	calculateTBN(modelMatrix, triangleData->tangent, bc_normalCoord);
+
+	//get world space normal by multiplying inverse TBN with tangent space normal
+	glm_mat3_inv(TBN, inverseTBN);
+	glm_mat3_mulv(inverseTBN, normal, worldSpaceNormal);
+
+	//add light into the scene
+	glm_normalize(lightDir);
+	glm_normalize(worldSpaceNormal);
+	intensity = glm_dot(worldSpaceNormal, lightDir);
+
+	color[0] = intensity * r;
+	color[1] = intensity * g;
+	color[2] = intensity * b;
+}
+
+// Compute barycentric coordinates (u, v, w) for the
+// sub-pixel point p with respect to triangle (a, b, c)
+void BarycentricSample(vec2 p, ivec2 a, ivec2 b, ivec2 c, vec3 barycentricCoords)
+{
+	float v0x = b[0] - a[0], v0y = b[1] - a[1];
+	float v1x = c[0] - a[0], v1y = c[1] - a[1];
+	float v2x = p[0] - a[0], v2y = p[1] - a[1];
+	float denom = v0x * v1y - v1x * v0y;
+	if (denom == 0.0f)
+	{
+		barycentricCoords[0] = -1.0f;
+		barycentricCoords[1] = -1.0f;
+		barycentricCoords[2] = -1.0f;
+		return;
+	}
+	barycentricCoords[1] = (v2x * v1y - v1x * v2y) / denom;
+	barycentricCoords[2] = (v0x * v2y - v2x * v0y) / denom;
+	barycentricCoords[0] = 1.0f - barycentricCoords[1] - barycentricCoords[2];
+}
+
+// MULTISAMPLING
+// Coverage and depth are evaluated at every sample of the pixel, returns the
+// mask of samples which are inside the triangle and pass the depth test
+// together with their barycentric coords.
+int rasterizeSamples(vertexBufferData* triangleData, ivec2 pixel,
+	ivec2 screenP1, ivec2 screenP2, ivec2 screenP3, const depthPlane* plane,
+	Framebuffer* framebuffer, vec3 sampleCoords[MAX_SAMPLES])
+{
+	const float (*offsets)[2] = getSampleOffsets(framebuffer->sampleCount);
+	int coverage = 0;
+
+	for (int s = 0; s < framebuffer->sampleCount; s++)
+	{
+		vec2 samplePosition = { pixel[0] + offsets[s][0], pixel[1] + offsets[s][1] };
+		BarycentricSample(samplePosition, screenP1, screenP2, screenP3, sampleCoords[s]);
+		if (sampleCoords[s][0] < 0 || sampleCoords[s][1] < 0 || sampleCoords[s][2] < 0)
+			continue;
+
+		float zValue = triangleData->vertexPos1[2] * sampleCoords[s][0] +
+			triangleData->vertexPos2[2] * sampleCoords[s][1] +
+			triangleData->vertexPos3[2] * sampleCoords[s][2];
+		if (testDepthSample(framebuffer, pixel[0], pixel[1], s, zValue, plane))
+			coverage |= 1 << s;
+	}
+	return coverage;
+}
+
 void drawTriangle(vertexBufferData triangleData,
-	unsigned char* texture, unsigned char* textureNormal,
-	float* depthBuffer, unsigned char* data, int mode)
+	Texture* texture, Texture* textureNormal, Sampler* sampler,
+	Framebuffer* framebuffer, int mode)
 {
 	if (mode == FILLED)
 	{
-		vec3 bc_screen, bc_normalCoord, bc_vertexCoord, worldSpaceNormal;
+		vec3 bc_screen, color;
 		ivec2 screenP1, screenP2, screenP3, pixels;
-		vec2 bc_textureCoord;
-		float r, g, b, normalR, normalB, normalG;
-		float zValue, intensity;
-		vec3 lightDir = { 0.0, 0.0, 1.0f };
-		mat3 inverseTBN;
+		float zValue;
+
+		setViewPort(triangleData.vertexPos1, &screenP1, framebuffer);
+		setViewPort(triangleData.vertexPos2, &screenP2, framebuffer);
+		setViewPort(triangleData.vertexPos3, &screenP3, framebuffer);
 
-		setViewPort(triangleData.vertexPos1, &screenP1);
-		setViewPort(triangleData.vertexPos2, &screenP2);
-		setViewPort(triangleData.vertexPos3, &screenP3);
+		// texture coord derivatives along the screen axes, constant over the triangle
+		vec2 dTextureCoordDx = { 0.0f, 0.0f }, dTextureCoordDy = { 0.0f, 0.0f };
+		calculateTextureCoordDerivatives(screenP1, screenP2, screenP3, triangleData.textureCoord1,
+			triangleData.textureCoord2, triangleData.textureCoord3, dTextureCoordDx, dTextureCoordDy);
+
+		// lets the triangle be stored in compressed depth tiles
+		depthPlane plane;
+		const depthPlane* trianglePlane = createDepthPlane(framebuffer, screenP1, screenP2, screenP3,
+			triangleData.vertexPos1[2], triangleData.vertexPos2[2], triangleData.vertexPos3[2], &plane) ? &plane : NULL;
 
 		/* get the bounding box of the triangle */
-		int maxX = min(RENDER_WIDTH - 1, max(screenP1[0], max(screenP2[0], screenP3[0])));
-		int minX = max(0, min(screenP1[0], min(screenP2[0], screenP3[0])));
-		int maxY = min(RENDER_HEIGHT - 1, max(screenP1[1], max(screenP2[1], screenP3[1])));
-		int minY = max(0, min(screenP1[1], min(screenP2[1], screenP3[1])));
+		int maxX = MIN(framebuffer->width - 1, MAX(screenP1[0], MAX(screenP2[0], screenP3[0])));
+		int minX = MAX(0, MIN(screenP1[0], MIN(screenP2[0], screenP3[0])));
+		int maxY = MIN(framebuffer->height - 1, MAX(screenP1[1], MAX(screenP2[1], screenP3[1])));
+		int minY = MAX(0, MIN(screenP1[1], MIN(screenP2[1], screenP3[1])));
+		touchFramebufferRegion(framebuffer, minX, minY, maxX, maxY);
 
 		for (pixels[0] = minX; pixels[0] <= maxX; pixels[0]++)
 		{
 			for (pixels[1] = minY; pixels[1] <= maxY; pixels[1]++)
 			{
+				if (framebuffer->sampleCount > 1)
+				{
+					// shade once per pixel at the pixel position, or at the first
+					// covered sample when the triangle does not cover the pixel position
+					vec3 sampleCoords[MAX_SAMPLES];
+					int coverage = rasterizeSamples(&triangleData, pixels, screenP1, screenP2, screenP3,
+						trianglePlane, framebuffer, sampleCoords);
+					if (!coverage)
+						continue;
+
+					Barycentric(pixels, screenP1, screenP2, screenP3, bc_screen);
+					if (bc_screen[0] < 0 || bc_screen[1] < 0 || bc_screen[2] < 0)
+					{
+						int s = 0;
+						while (!(coverage & (1 << s)))
+							s++;
+						glm_vec3_copy(sampleCoords[s], bc_screen);
+					}
+					shadeFragment(&triangleData, bc_screen, dTextureCoordDx, dTextureCoordDy,
+						texture, textureNormal, sampler, color);
+					setPixelSamples(color[0], color[1], color[2], pixels[0], pixels[1], coverage, framebuffer);
+					continue;
+				}
+
 				Barycentric(pixels, screenP1, screenP2, screenP3, bc_screen);
 
 				if (bc_screen[0] < 0 || bc_screen[1] < 0 || bc_screen[2] < 0)
 					continue;
 
-				// texture sampler
-				bc_textureCoord[0] = triangleData.textureCoord1[0] * bc_screen[0] +
-					triangleData.textureCoord2[0] * bc_screen[1] +
-					triangleData.textureCoord3[0] * bc_screen[2];
-				bc_textureCoord[1] = triangleData.textureCoord1[1] * bc_screen[0] +
-					triangleData.textureCoord2[1] * bc_screen[1] +
-					triangleData.textureCoord3[1] * bc_screen[2];
-
-				//get color value of the pixel
-				getTextureColor(bc_textureCoord, textureWidth, textureHeight, numOfChannels,
-					texture, &r, &g, &b);
-				getTextureColor(bc_textureCoord, normalTextureWidth, normalTextureHeight, normalNumOfChannels,
-					textureNormal, &normalR, &normalG, &normalB);
-
-				//interpolate the normal vectors
-				bc_normalCoord[0] = triangleData.vertexNormal1[0] * bc_screen[0] +
-					triangleData.vertexNormal2[0] * bc_screen[1] +
-					triangleData.vertexNormal3[0] * bc_screen[2];
-				bc_normalCoord[1] = triangleData.vertexNormal1[1] * bc_screen[0] +
-					triangleData.vertexNormal2[1] * bc_screen[1] +
-					triangleData.vertexNormal3[1] * bc_screen[2];
-				bc_normalCoord[2] = triangleData.vertexNormal1[2] * bc_screen[0] +
-					triangleData.vertexNormal2[2] * bc_screen[1] +
-					triangleData.vertexNormal3[2] * bc_screen[2];
-
-				calculateTBN(modelMatrix, triangleData.tangent, bc_normalCoord);
-
-				normal[0] = (normalR) * 2.0 -1.0; //normalize normal vector to [-1, 1]
-				normal[1] = (normalG) * 2.0 -1.0;
-				normal[2] = (normalB) * 2.0 -1.0;
-				
-				//get world space normal by multiplying inverse TBN with tangent space normal
-				glm_mat3_inv(TBN, inverseTBN);
-				glm_mat3_mulv(inverseTBN, normal, worldSpaceNormal);
-				
-				//add light into the scene
-				glm_normalize(lightDir);
-				glm_normalize(worldSpaceNormal);
-				intensity = glm_dot(worldSpaceNormal, lightDir);
-
-				// depth test
+				// depth test, occluded fragments are not shaded
 				zValue = triangleData.vertexPos1[2] * bc_screen[0] + 
 						 triangleData.vertexPos2[2] * bc_screen[1] + 
 						 triangleData.vertexPos3[2] * bc_screen[2];
-				if (zValue > depthBuffer[pixels[0] + pixels[1] * RENDER_WIDTH])
+				if (testDepthSample(framebuffer, pixels[0], pixels[1], 0, zValue, trianglePlane))
 				{
-					depthBuffer[pixels[0] + pixels[1] * RENDER_WIDTH] = zValue;
-					setPixel(intensity * r, intensity * g, intensity * b, pixels[0], pixels[1], data);
+					shadeFragment(&triangleData, bc_screen, dTextureCoordDx, dTextureCoordDy,
+						texture, textureNormal, sampler, color);
+					setPixel(color[0], color[1], color[2], pixels[0], pixels[1], framebuffer);
 				}
 			}
 		}
 	}
 	else if (mode == MESH)
 	{
-		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos1, triangleData.vertexPos2, data);
-		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos2, triangleData.vertexPos3, data);
-		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos3, triangleData.vertexPos1, data);
+		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos1, triangleData.vertexPos2, framebuffer);
+		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos2, triangleData.vertexPos3, framebuffer);
+		drawLine(1.0f, 1.0f, 1.0f, triangleData.vertexPos3, triangleData.vertexPos1, framebuffer);
+	}
+}
+
+// VISIBILITY BUFFER
+// The triangles are rasterized first, storing only the id and the barycentric
+// coords of the closest triangle per pixel. The shading pass then runs the
+// fragment shader exactly once per covered pixel, independent of overdraw.
+void clearVisibilityBuffer(Framebuffer* framebuffer)
+{
+	clearFramebuffer(framebuffer, TILE_CLEAR_VISIBILITY);
+}
+
+void drawTriangleVisibility(vertexBufferData* triangleData, int triangleId,
+	Framebuffer* framebuffer)
+{
+	visibilitySample* visibilityBuffer = framebuffer->visibility;
+	vec3 bc_screen;
+	ivec2 screenP1, screenP2, screenP3, pixels;
+	float zValue;
+
+	setViewPort(triangleData->vertexPos1, &screenP1, framebuffer);
+	setViewPort(triangleData->vertexPos2, &screenP2, framebuffer);
+	setViewPort(triangleData->vertexPos3, &screenP3, framebuffer);
+
+	depthPlane plane;
+	const depthPlane* trianglePlane = createDepthPlane(framebuffer, screenP1, screenP2, screenP3,
+		triangleData->vertexPos1[2], triangleData->vertexPos2[2], triangleData->vertexPos3[2], &plane) ? &plane : NULL;
+
+	/* get the bounding box of the triangle */
+	int maxX = MIN(framebuffer->width - 1, MAX(screenP1[0], MAX(screenP2[0], screenP3[0])));
+	int minX = MAX(0, MIN(screenP1[0], MIN(screenP2[0], screenP3[0])));
+	int maxY = MIN(framebuffer->height - 1, MAX(screenP1[1], MAX(screenP2[1], screenP3[1])));
+	int minY = MAX(0, MIN(screenP1[1], MIN(screenP2[1], screenP3[1])));
+	touchFramebufferRegion(framebuffer, minX, minY, maxX, maxY);
+
+	for (pixels[0] = minX; pixels[0] <= maxX; pixels[0]++)
+	{
+		for (pixels[1] = minY; pixels[1] <= maxY; pixels[1]++)
+		{
+			if (framebuffer->sampleCount > 1)
+			{
+				vec3 sampleCoords[MAX_SAMPLES];
+				int coverage = rasterizeSamples(triangleData, pixels, screenP1, screenP2, screenP3,
+					trianglePlane, framebuffer, sampleCoords);
+				int sampleIndex = (pixels[0] + pixels[1] * framebuffer->width) * framebuffer->sampleCount;
+				for (int s = 0; s < framebuffer->sampleCount; s++)
+				{
+					if (coverage & (1 << s))
+					{
+						visibilityBuffer[sampleIndex + s].triangleId = triangleId;
+						visibilityBuffer[sampleIndex + s].barycentric1 = sampleCoords[s][1];
+						visibilityBuffer[sampleIndex + s].barycentric2 = sampleCoords[s][2];
+					}
+				}
+				continue;
+			}
+
+			Barycentric(pixels, screenP1, screenP2, screenP3, bc_screen);
+
+			if (bc_screen[0] < 0 || bc_screen[1] < 0 || bc_screen[2] < 0)
+				continue;
+
+			// depth test
+			zValue = triangleData->vertexPos1[2] * bc_screen[0] +
+					 triangleData->vertexPos2[2] * bc_screen[1] +
+					 triangleData->vertexPos3[2] * bc_screen[2];
+			int index = pixels[0] + pixels[1] * framebuffer->width;
+			if (testDepthSample(framebuffer, pixels[0], pixels[1], 0, zValue, trianglePlane))
+			{
+				visibilityBuffer[index].triangleId = triangleId;
+				visibilityBuffer[index].barycentric1 = bc_screen[1];
+				visibilityBuffer[index].barycentric2 = bc_screen[2];
+			}
+		}
+	}
+}
+
+void shadeVisibilityBuffer(vertexBufferData* triangles, Framebuffer* framebuffer,
+	Texture* texture, Texture* textureNormal, Sampler* sampler)
+{
+	vec3 bc_screen, color;
+	ivec2 screenP1, screenP2, screenP3;
+	vec2 dTextureCoordDx, dTextureCoordDy;
+	int lastTriangleId = NO_TRIANGLE;
+
+	for (int tileY = 0; tileY < framebuffer->tilesY; tileY++)
+	{
+		for (int tileX = 0; tileX < framebuffer->tilesX; tileX++)
+		{
+			// no triangle touched the tile since the last clear
+			if (isTileEmpty(framebuffer, tileX, tileY))
+				continue;
+
+			int maxX = MIN((tileX + 1) * TILE_SIZE, framebuffer->width);
+			int maxY = MIN((tileY + 1) * TILE_SIZE, framebuffer->height);
+			touchFramebufferRegion(framebuffer, tileX * TILE_SIZE, tileY * TILE_SIZE, maxX - 1, maxY - 1);
+
+			for (int y = tileY * TILE_SIZE; y < maxY; y++)
+			{
+				for (int x = tileX * TILE_SIZE; x < maxX; x++)
+				{
+					// with multisampling the pixel is shaded once for each triangle covering its samples
+					visibilitySample* samples = &framebuffer->visibility[(x + y * framebuffer->width) * framebuffer->sampleCount];
+					int shadedSamples = 0;
+					for (int s = 0; s < framebuffer->sampleCount; s++)
+					{
+						visibilitySample* sample = &samples[s];
+						if (sample->triangleId == NO_TRIANGLE || (shadedSamples & (1 << s)))
+							continue;
+
+						int coverage = 0;
+						for (int t = s; t < framebuffer->sampleCount; t++)
+						{
+							if (samples[t].triangleId == sample->triangleId)
+								coverage |= 1 << t;
+						}
+						shadedSamples |= coverage;
+
+						vertexBufferData* triangleData = &triangles[sample->triangleId];
+						// neighbouring pixels mostly belong to the same triangle
+						if (sample->triangleId != lastTriangleId)
+						{
+							setViewPort(triangleData->vertexPos1, &screenP1, framebuffer);
+							setViewPort(triangleData->vertexPos2, &screenP2, framebuffer);
+							setViewPort(triangleData->vertexPos3, &screenP3, framebuffer);
+							glm_vec2_zero(dTextureCoordDx);
+							glm_vec2_zero(dTextureCoordDy);
+							calculateTextureCoordDerivatives(screenP1, screenP2, screenP3, triangleData->textureCoord1,
+								triangleData->textureCoord2, triangleData->textureCoord3, dTextureCoordDx, dTextureCoordDy);
+							lastTriangleId = sample->triangleId;
+						}
+
+						bc_screen[1] = sample->barycentric1;
+						bc_screen[2] = sample->barycentric2;
+						bc_screen[0] = 1.0f - bc_screen[1] - bc_screen[2];
+						if (framebuffer->sampleCount > 1)
+						{
+							// same shading position as the forward path
+							vec3 pixelCoords;
+							ivec2 pixel = { x, y };
+							Barycentric(pixel, screenP1, screenP2, screenP3, pixelCoords);
+							if (pixelCoords[0] >= 0 && pixelCoords[1] >= 0 && pixelCoords[2] >= 0)
+								glm_vec3_copy(pixelCoords, bc_screen);
+						}
+						shadeFragment(triangleData, bc_screen, dTextureCoordDx, dTextureCoordDy,
+							texture, textureNormal, sampler, color);
+						setPixelSamples(color[0], color[1], color[2], x, y, coverage, framebuffer);
+					}
+				}
+			}
+		}
 	}
 }
 
@@ -356,67 +644,108 @@ void vertexShader(vec3 vertexPos, vec3 outputPos, mat4 model, mat4 view, mat4 pr
 	outputPos[2] = -mvp[2] / w;
 }
 
-int main()
+// Camera path for headless rendering, one "eyeX eyeY eyeZ targetX targetY targetZ"
+// line per frame, lines starting with # are skipped. Returns NULL on failure.
+cameraPathPoint* loadCameraPath(const char* filename, int* numOfPoints)
 {
-	//OpenGL window to show the rendered image quickly
-	OpenGLInit();
+	FILE* file = fopen(filename, "r");
+	if (!file)
+		return NULL;
 
-	unsigned char* data = 0;
-	unsigned char* depthBuffer = 0;
-	createColorBuffer(RENDER_WIDTH, RENDER_HEIGHT, &data);
-	createDepthBuffer(RENDER_WIDTH, RENDER_HEIGHT, &depthBuffer);
-
-	// obj load
-	size_t numOfTriangles = LoadObjAndConvert("../../Resources/african_head.obj");
-	if (0 == numOfTriangles)
+	int capacity = 64;
+	cameraPathPoint* points = malloc(capacity * sizeof(cameraPathPoint));
+	char line[256];
+	*numOfPoints = 0;
+	while (points && fgets(line, sizeof(line), file))
 	{
-		printf("\nfailed to load & conv\n");
-		return -1;
+		cameraPathPoint point;
+		if (line[0] == '#' || sscanf(line, "%f %f %f %f %f %f", &point.eye[0], &point.eye[1], &point.eye[2],
+			&point.target[0], &point.target[1], &point.target[2]) != 6)
+			continue;
+		if (*numOfPoints == capacity)
+		{
+			capacity *= 2;
+			cameraPathPoint* grown = realloc(points, capacity * sizeof(cameraPathPoint));
+			if (!grown)
+				free(points);
+			points = grown;
+			if (!points)
+				break;
+		}
+		points[(*numOfPoints)++] = point;
 	}
+	fclose(file);
+	if (points && *numOfPoints == 0)
+	{
+		free(points);
+		points = NULL;
+	}
+	return points;
+}
+
+// the viewer renders until its window is closed, headless rendering stops after numOfFrames
+int isRendering(TripleBuffer* displayBuffer, int frameNumber, int numOfFrames)
+{
+	if (displayBuffer)
+		return !isTripleBufferClosed(displayBuffer);
+	return frameNumber < numOfFrames;
+}
 
-	// texture load
-	unsigned char* texture = stbi_load("../../Resources/african_head_diffuse.tga",
-		&textureWidth, &textureHeight, &numOfChannels, 0);
+// headless frames advance by a fixed step, so the frames do not depend on the render speed
+double getFrameTime(int isHeadless, int frameNumber)
+{
+#ifdef TINY_RENDERER_VIEWER
+	if (!isHeadless)
+		return glfwGetTime();
+#else
+	(void)isHeadless;
+#endif
+	return (double)frameNumber / VIDEO_FRAME_RATE;
+}
 
-	unsigned char* textureNormal = stbi_load("../../Resources/african_head_nm_tangent.tga",
-		&normalTextureWidth, &normalTextureHeight, &normalNumOfChannels, 0);
+// Renders the frames of a job, on the main thread when headless and on its own thread
+// next to the viewer. Matches threadFunction so it can be started with startThread.
+void renderFrames(void* arg)
+{
+	renderJob* job = arg;
+	int isHeadless = job->isHeadless;
+	int shadingMode = job->shadingMode;
+	ImageWriter* imageWriter = job->imageWriter;
+	TripleBuffer* displayBuffer = job->displayBuffer;
+	cameraPathPoint* cameraPath = job->cameraPath;
+	int numOfCameraPathPoints = job->numOfCameraPathPoints;
+	size_t numOfTriangles = job->numOfTriangles;
+	vertexBufferData* frameTriangles = job->frameTriangles;
+	Texture* texture = job->texture;
+	Texture* textureNormal = job->textureNormal;
+	Sampler* sampler = &job->sampler;
+	int frameNumber = 0;
+	// the first frame replaces the whole display
+	pixelRect previousRect = { 0, 0, INT_MAX, INT_MAX };
 
 	//variables
 	vec3 transformedP1, transformedP2, transformedP3;
 	vertexBufferData triangleData;
 
-	glm_mat4_identity(viewMatrix);
-	glm_mat4_identity(projectionMatrix);
-	glm_mat4_identity(modelMatrix);
-
-	//glm_ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 10.0f, projectionMatrix);
-	glm_perspective(glm_rad(45.0f), 1.0f, 0.1f, 100.0f, projectionMatrix);
-	glm_lookat((vec3) { 0.0f, 0.0f, 3.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, viewMatrix);
-
-	while (!glfwWindowShouldClose(window))
+	while (isRendering(displayBuffer, frameNumber, job->numOfFrames))
 	{
-		clearColor(0, 0, 0, data);
-		clearDepthBuffer(-1.0f, depthBuffer);
-		glfwPollEvents();
+		Framebuffer* framebuffer = acquireOutputFramebuffer(imageWriter);
+		clearColor(0, 0, 0, framebuffer);
+		clearDepthBuffer(-1.0f, framebuffer);
+		if (shadingMode == VISIBILITY_BUFFER_SHADING)
+			clearVisibilityBuffer(framebuffer);
 
 		//transformations
 		glm_mat4_identity(modelMatrix);
-		glm_rotate(modelMatrix, glfwGetTime(), (vec3) { 0.0, 1.0f, 0.0 });
+		glm_rotate(modelMatrix, getFrameTime(isHeadless, frameNumber), (vec3) { 0.0, 1.0f, 0.0 });
+		if (cameraPath)
+		{
+			cameraPathPoint* point = &cameraPath[frameNumber % numOfCameraPathPoints];
+			glm_lookat(point->eye, point->target, (vec3) { 0.0f, 1.0f, 0.0f }, viewMatrix);
+		}
 
 		for (size_t i = 0; i < numOfTriangles; i++)
 		{
-			//calculate tangent value of a triangle
-			//only one tangent vector is defined for a triangle(3-vertex)
-			vec3 edge1, edge2, deltaUV1, deltaUV2, tangent;
-			glm_vec3_sub(vertexArray[2 + i * 3], vertexArray[0 + i * 3], edge1);
-			glm_vec3_sub(vertexArray[1 + i * 3], vertexArray[0 + i * 3], edge2);
-			glm_vec3_sub(textureArray[2 + i * 3], textureArray[0 + i * 3], deltaUV1);
-			glm_vec3_sub(textureArray[1 + i * 3], textureArray[0 + i * 3], deltaUV2);
-			float f = 1.0f / (deltaUV1[0] * deltaUV2[1] - deltaUV2[0] * deltaUV1[1]);
-			tangent[0] = f * (deltaUV2[1] * edge1[0] - deltaUV1[1] * edge2[0]);
-			tangent[1] = f * (deltaUV2[1] * edge1[1] - deltaUV1[1] * edge2[1]);
-			tangent[2] = f * (deltaUV2[1] * edge1[2] - deltaUV1[1] * edge2[2]);
-
 			//get projected output position from vertex shader
 			vertexShader(vertexArray[0 + i * 3], transformedP1, modelMatrix, viewMatrix, projectionMatrix);
 			vertexShader(vertexArray[1 + i * 3], transformedP2, modelMatrix, viewMatrix, projectionMatrix);
@@ -432,30 +761,378 @@ int main()
 			memcpy(triangleData.vertexNormal1, normalArray[0 + i * 3], sizeof(normalArray[0 + i * 3]));
 			memcpy(triangleData.vertexNormal2, normalArray[1 + i * 3], sizeof(normalArray[1 + i * 3]));
 			memcpy(triangleData.vertexNormal3, normalArray[2 + i * 3], sizeof(normalArray[2 + i * 3]));
-			memcpy(triangleData.tangent, tangent, sizeof(tangent));
-
-			drawTriangle(
-				triangleData,
-				texture,
-				textureNormal,
-				depthBuffer,
-				data, 
-				FILLED
-			);
+			memcpy(triangleData.tangent, tangentArray[i], sizeof(tangentArray[i]));
+
+			if (shadingMode == VISIBILITY_BUFFER_SHADING)
+			{
+				frameTriangles[i] = triangleData;
+				drawTriangleVisibility(&frameTriangles[i], (int)i, framebuffer);
+			}
+			else
+			{
+				drawTriangle(
+					triangleData,
+					texture,
+					textureNormal,
+					sampler,
+					framebuffer,
+					FILLED
+				);
+			}
+		}
+		if (shadingMode == VISIBILITY_BUFFER_SHADING)
+			shadeVisibilityBuffer(frameTriangles, framebuffer, texture, textureNormal, sampler);
+		resolveMultisampleColor(framebuffer);
+		// write the clears of the tiles no triangle touched
+		resolveFramebuffer(framebuffer);
+		// the display picks the newest frame, the renderer never waits for vsync
+		if (displayBuffer)
+		{
+			// pixels differ from the previous frame only where either frame was drawn,
+			// the background around them is the same clear color
+			pixelRect dirtyRect = framebuffer->drawnRect;
+			unionRect(&dirtyRect, &previousRect);
+			dirtyRect.maxX = MIN(dirtyRect.maxX, framebuffer->width);
+			dirtyRect.maxY = MIN(dirtyRect.maxY, framebuffer->height);
+			previousRect = framebuffer->drawnRect;
+			memcpy(getTripleBufferBack(displayBuffer), framebuffer->color, (size_t)framebuffer->stride * framebuffer->height);
+			publishTripleBuffer(displayBuffer, &dirtyRect);
 		}
-		textureData = data;
-		MainLoop();
+		// the image is written as RGB, the alpha channel of RGBA8 is dropped by the image writer
+		char outputFilename[MAX_OUTPUT_FILENAME];
+		if (job->isNumberedOutput)
+			snprintf(outputFilename, sizeof(outputFilename), "../../../output_images/frame%05d%s",
+				frameNumber, getImageExtension(job->outputFormat));
+		else
+			snprintf(outputFilename, sizeof(outputFilename), "../../../output_images/projection%s",
+				getImageExtension(job->outputFormat));
+		submitOutputFramebuffer(imageWriter, framebuffer, outputFilename, 1);
+		frameNumber++;
+	}
+}
+
+#ifdef TINY_RENDERER_VIEWER
+// The window shows the newest finished frame at vsync while the renderer runs ahead on its
+// own thread, the title reports the frames per second of the renderer.
+int displayFrames(renderJob* job)
+{
+	Thread* renderThread = startThread(renderFrames, job);
+	if (!renderThread)
+		return 0;
+
+	double rateTime = glfwGetTime();
+	int rateFrames = 0;
+	while (!glfwWindowShouldClose(window))
+	{
+		glfwPollEvents();
+		pixelRect dirtyRect;
+		textureData = acquireTripleBufferFront(job->displayBuffer, &dirtyRect);
+		MainLoop(&dirtyRect);
 		glfwSwapBuffers(window);
-		writeImage("../../../output_images/projection.png", RENDER_WIDTH, RENDER_HEIGHT,
-			3, data, RENDER_WIDTH * NUMBER_OF_CHANNELS, 1);
+
+		double time = glfwGetTime();
+		if (time - rateTime >= 1.0)
+		{
+			int numOfFrames = getNumberOfPublishedFrames(job->displayBuffer);
+			char title[64];
+			snprintf(title, sizeof(title), "TINY RENDERER - %.1f fps", (numOfFrames - rateFrames) / (time - rateTime));
+			glfwSetWindowTitle(window, title);
+			rateTime = time;
+			rateFrames = numOfFrames;
+		}
+	}
+	closeTripleBuffer(job->displayBuffer);
+	joinThread(renderThread);
+	return 1;
+}
+#endif
+
+// index of the value in the option names, -1 when it is none of them
+static int getOptionIndex(const char* value, const char** names, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		if (strcmp(value, names[i]) == 0)
+			return i;
+	}
+	return -1;
+}
+
+// usage: tiny-renderer [--frames N] [--camera path] [--format png|rgb|ppm|qoi]
+//	[--numbered 0|1] [--write buffered|direct] [--filter nearest|anisotropic]
+//	[--taps 1-16] [--shading forward|visibility] [--depth d32f|d24|d16]
+//	[--depth-test less|lequal|greater|gequal|always] [--samples 1|2|4]
+//	[--depth-compression 0|1] [--png-threads 0|N|all] [--png-level 0-9]
+//	[--png-filter adaptive|none|sub|up|average|paeth] [width height [video]]
+// The render size defaults to RENDER_WIDTH x RENDER_HEIGHT. With video the frames are
+// streamed to stdout ("-"), a pipe ("|command") or a file instead of written as images,
+// raw RGB for a .rgb file and y4m otherwise.
+// --frames renders N frames without a window, --camera moves the camera along a path
+// loaded by loadCameraPath, one point per frame. Builds without TINY_RENDERER_VIEWER are
+// always headless and render one frame, or one per camera path point, by default.
+// --format picks the image format, png by default, rgb, ppm and qoi skip the compression
+// for fast frame dumps. --numbered 1 writes frame00000, frame00001... instead of
+// overwriting projection, --write direct bypasses the page cache where it is supported.
+// --filter anisotropic filters the diffuse texture with up to --taps samples per pixel.
+// --shading visibility shades each visible pixel once after all triangles are drawn.
+// --depth picks the depth buffer format, --depth-test the compare function, greater and
+// gequal use reversed z. --samples 2 or 4 enables multisample anti-aliasing.
+// --depth-compression 1 stores the depth of tiles covered by a few triangles as plane equations.
+// --png-threads 0 encodes PNGs with stb_image_write, N or all filter and deflate them in row
+// bands on N or all cores instead, --png-level and --png-filter apply to both encoders.
+int main(int argc, char** argv)
+{
+	int numOfFrames = 0;
+	const char* cameraPathFilename = NULL;
+	int outputFormat = IMAGE_PNG;
+	int isNumberedOutput = 0;
+	int writeMode = WRITE_BUFFERED;
+	// FILTER_ANISOTROPIC takes up to maxAnisotropicTaps samples along the pixel footprint
+	Sampler sampler = { FILTER_NEAREST, MAX_ANISOTROPIC_TAPS };
+	// VISIBILITY_BUFFER_SHADING is opt-in, it reconstructs the barycentrics in float and
+	// does not match forward shading bit for bit
+	int shadingMode = FORWARD_SHADING;
+	// DEPTH_D16 halves the depth buffer traffic, the precision is enough for single objects
+	int depthFormat = DEPTH_D32F;
+	// near is greater with reversed z
+	int depthCompare = DEPTH_GREATER;
+	int sampleCount = 1;
+	// opt-in since it saves depth traffic only for scenes with large triangles
+	int isDepthCompressed = 0;
+	// PNGs are encoded by stb_image_write by default, every band border of the
+	// parallel encoder costs a little compression
+	PNGWriterSettings pngSettings = { 0, PNG_FILTER_ADAPTIVE, 8, 0 };
+	int argument = 1;
+	for (; argument + 1 < argc && strncmp(argv[argument], "--", 2) == 0; argument += 2)
+	{
+		const char* value = argv[argument + 1];
+		if (strcmp(argv[argument], "--frames") == 0)
+			numOfFrames = atoi(value);
+		else if (strcmp(argv[argument], "--camera") == 0)
+			cameraPathFilename = value;
+		else if (strcmp(argv[argument], "--format") == 0)
+			outputFormat = getImageFormatByName(value);
+		else if (strcmp(argv[argument], "--numbered") == 0)
+			isNumberedOutput = atoi(value) != 0;
+		else if (strcmp(argv[argument], "--write") == 0)
+			writeMode = strcmp(value, "direct") == 0 ? WRITE_DIRECT : strcmp(value, "buffered") == 0 ? WRITE_BUFFERED : -1;
+		else if (strcmp(argv[argument], "--filter") == 0)
+			sampler.filter = getOptionIndex(value, (const char*[]) { "nearest", "anisotropic" }, 2);
+		else if (strcmp(argv[argument], "--taps") == 0)
+			sampler.maxAnisotropicTaps = atoi(value);
+		else if (strcmp(argv[argument], "--shading") == 0)
+			shadingMode = getOptionIndex(value, (const char*[]) { "forward", "visibility" }, 2);
+		else if (strcmp(argv[argument], "--depth") == 0)
+			depthFormat = getOptionIndex(value, (const char*[]) { "d32f", "d24", "d16" }, 3);
+		else if (strcmp(argv[argument], "--depth-test") == 0)
+			depthCompare = getOptionIndex(value, (const char*[]) { "less", "lequal", "greater", "gequal", "always" }, 5);
+		else if (strcmp(argv[argument], "--samples") == 0)
+			sampleCount = atoi(value);
+		else if (strcmp(argv[argument], "--depth-compression") == 0)
+			isDepthCompressed = atoi(value) != 0;
+		else if (strcmp(argv[argument], "--png-threads") == 0)
+		{
+			pngSettings.numOfThreads = strcmp(value, "all") == 0 ? 0 : atoi(value);
+			pngSettings.isParallel = strcmp(value, "all") == 0 || pngSettings.numOfThreads > 0;
+		}
+		else if (strcmp(argv[argument], "--png-level") == 0)
+			pngSettings.level = atoi(value);
+		else if (strcmp(argv[argument], "--png-filter") == 0)
+			pngSettings.filter = getOptionIndex(value,
+				(const char*[]) { "adaptive", "none", "sub", "up", "average", "paeth" }, 6) + PNG_FILTER_ADAPTIVE;
+		else
+		{
+			fprintf(stderr, "\nunknown option %s\n", argv[argument]);
+			return -1;
+		}
+	}
+	if (outputFormat < 0 || writeMode < 0)
+	{
+		fprintf(stderr, "\nunknown output format or write mode\n");
+		return -1;
+	}
+	if (sampler.filter < 0 || sampler.maxAnisotropicTaps < 1 || sampler.maxAnisotropicTaps > MAX_ANISOTROPIC_TAPS)
+	{
+		fprintf(stderr, "\nunknown texture filter or tap count\n");
+		return -1;
+	}
+	if (shadingMode < 0)
+	{
+		fprintf(stderr, "\nunknown shading mode\n");
+		return -1;
+	}
+	if (depthFormat < 0 || depthCompare < 0)
+	{
+		fprintf(stderr, "\nunknown depth format or depth test\n");
+		return -1;
+	}
+	if (sampleCount != 1 && sampleCount != 2 && sampleCount != 4)
+	{
+		fprintf(stderr, "\nthe sample count has to be 1, 2 or 4\n");
+		return -1;
 	}
-	glfwDestroyWindow(window);
-	glfwTerminate();
+	if (pngSettings.numOfThreads < 0 || pngSettings.level < 0 || pngSettings.level > 9 ||
+		pngSettings.filter < PNG_FILTER_ADAPTIVE)
+	{
+		fprintf(stderr, "\nunknown PNG thread count, level or filter\n");
+		return -1;
+	}
+
+	int renderWidth = RENDER_WIDTH;
+	int renderHeight = RENDER_HEIGHT;
+	if (argc - argument >= 2)
+	{
+		renderWidth = atoi(argv[argument]);
+		renderHeight = atoi(argv[argument + 1]);
+	}
+
+	cameraPathPoint* cameraPath = NULL;
+	int numOfCameraPathPoints = 0;
+	if (cameraPathFilename)
+	{
+		cameraPath = loadCameraPath(cameraPathFilename, &numOfCameraPathPoints);
+		if (!cameraPath)
+		{
+			fprintf(stderr, "\nfailed to load the camera path %s\n", cameraPathFilename);
+			return -1;
+		}
+		if (numOfFrames <= 0)
+			numOfFrames = numOfCameraPathPoints;
+	}
+
+#ifdef TINY_RENDERER_VIEWER
+	int isHeadless = numOfFrames > 0;
+	//OpenGL window to show the rendered image quickly
+	if (!isHeadless)
+		OpenGLInit();
+#else
+	int isHeadless = 1;
+	if (numOfFrames <= 0)
+		numOfFrames = 1;
+#endif
+
+	// a ring of framebuffers, the next frame is rendered while the previous ones are encoded
+	Framebuffer framebuffers[OUTPUT_RING_SIZE];
+	for (int i = 0; i < OUTPUT_RING_SIZE; i++)
+	{
+		if (!createFramebuffer(&framebuffers[i], renderWidth, renderHeight, FORMAT_RGBA8, depthFormat,
+			sampleCount, shadingMode == VISIBILITY_BUFFER_SHADING))
+		{
+			fprintf(stderr, "\nfailed to create the framebuffer\n");
+			return -1;
+		}
+		// depth is cleared to the far plane, the compare function decides its direction
+		setDepthState(&framebuffers[i], depthCompare, depthCompare != DEPTH_LESS && depthCompare != DEPTH_LEQUAL);
+		if (isDepthCompressed && !setDepthCompression(&framebuffers[i], 1))
+		{
+			fprintf(stderr, "\nfailed to create the compressed depth tiles\n");
+			return -1;
+		}
+	}
+	if (!setPNGWriterSettings(&pngSettings))
+	{
+		fprintf(stderr, "\nfailed to create the PNG writer threads\n");
+		return -1;
+	}
+	setImageWriteMode(writeMode);
+	// PNG encoding runs on background threads and does not block the next frame
+	ImageWriter* imageWriter = createImageWriter(framebuffers, OUTPUT_RING_SIZE, 0);
+	if (!imageWriter)
+	{
+		fprintf(stderr, "\nfailed to create the image writer\n");
+		return -1;
+	}
+	VideoStream* videoStream = NULL;
+	if (argc - argument >= 3)
+	{
+		// the file is preallocated when the number of frames is known
+		const char* videoTarget = argv[argument + 2];
+		videoStream = openVideoStream(videoTarget, getVideoFormat(videoTarget), renderWidth, renderHeight,
+			VIDEO_FRAME_RATE, isHeadless ? numOfFrames : 0);
+		if (!videoStream || !setImageWriterStream(imageWriter, videoStream))
+		{
+			fprintf(stderr, "failed to open the video stream\n");
+			return -1;
+		}
+	}
+
+	// obj load, the converted mesh is cached next to the obj and mapped on later runs
+	size_t numOfTriangles = LoadObjAndConvert("../../Resources/african_head.obj");
+	if (0 == numOfTriangles)
+	{
+		fprintf(stderr, "\nfailed to load & conv\n");
+		return -1;
+	}
+
+	// texture load, textures are shared through the registry and decoded only once
+	// tangent space normal map is stored as two channels, z is reconstructed while shading
+	// preprocessed texture files are mapped, the others are decoded in parallel
+	const char* texturePaths[] = { "../../Resources/african_head_diffuse.tga",
+		"../../Resources/african_head_nm_tangent.tga" };
+	const int textureTypes[] = { TEXTURE_COLOR, TEXTURE_NORMAL_MAP };
+	Texture* textures[2];
+	int numOfFailedTextures = acquireTextures(texturePaths, textureTypes, 2, textures);
+	Texture* texture = textures[0];
+	Texture* textureNormal = textures[1];
+	if (numOfFailedTextures)
+	{
+		fprintf(stderr, "\nfailed to load textures\n");
+		return -1;
+	}
+
+	vertexBufferData* frameTriangles = malloc(numOfTriangles * sizeof(vertexBufferData));
+
+	glm_mat4_identity(viewMatrix);
+	glm_mat4_identity(projectionMatrix);
+	glm_mat4_identity(modelMatrix);
+
+	//glm_ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 10.0f, projectionMatrix);
+	glm_perspective(glm_rad(45.0f), (float)renderWidth / renderHeight, 0.1f, 100.0f, projectionMatrix);
+	glm_lookat((vec3) { 0.0f, 0.0f, 3.0f }, (vec3) { 0.0f, 0.0f, 0.0f }, (vec3) { 0.0f, 1.0f, 0.0f }, viewMatrix);
+
+	renderJob job = { isHeadless, numOfFrames, shadingMode, outputFormat, isNumberedOutput, imageWriter, NULL,
+		cameraPath, numOfCameraPathPoints, numOfTriangles, frameTriangles, texture, textureNormal, sampler };
+#ifdef TINY_RENDERER_VIEWER
+	if (!isHeadless)
+	{
+		job.displayBuffer = createTripleBuffer((size_t)framebuffers[0].stride * renderHeight);
+		textureDataWidth = renderWidth;
+		textureDataHeight = renderHeight;
+		textureDataBytesPerPixel = framebuffers[0].bytesPerPixel;
+		textureDataStride = framebuffers[0].stride;
+		if (!job.displayBuffer || !displayFrames(&job))
+		{
+			fprintf(stderr, "\nfailed to start the render thread\n");
+			return -1;
+		}
+		destroyTripleBuffer(job.displayBuffer);
+	}
+	else
+#endif
+		renderFrames(&job);
+
+#ifdef TINY_RENDERER_VIEWER
+	if (!isHeadless)
+	{
+		OpenGLRelease();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+	}
+#endif
+
+	releaseTexture(texture);
+	releaseTexture(textureNormal);
+	destroyTextureRegistry();
 
-	free(data);
-	free(vertexArray);
-	free(normalArray);
-	free(textureArray);
+	// waits for the frames still being encoded
+	destroyImageWriter(imageWriter);
+	closeVideoStream(videoStream);
+	destroyPNGWriter();
+	for (int i = 0; i < OUTPUT_RING_SIZE; i++)
+		destroyFramebuffer(&framebuffers[i]);
+	free(frameTriangles);
+	free(cameraPath);
+	releaseMesh();
 	return 0;
 }
 
@@ -1,6 +1,14 @@
 #pragma once
+#include "texture.h"
+#include "framebuffer.h"
+#include "imageWriter.h"
+#include "tripleBuffer.h"
 
-char* textureData;
+extern char* textureData;
+extern int textureDataWidth;
+extern int textureDataHeight;
+extern int textureDataBytesPerPixel;
+extern int textureDataStride;
 typedef struct {
 	vec3 vertexPos1;
 	vec3 vertexPos2;
@@ -14,22 +22,58 @@ typedef struct {
 	vec3 tangent;
 }vertexBufferData;
 
-void createColorBuffer(int width, int height, unsigned char** data);
-void createDepthBuffer(int width, int height, float** depthBuffer);
-void clearDepthBuffer(float zValue, float* depthBuffer);
-void writeImage(const char* filename, int width, int height, int comp,
-	const void* data, int stride, unsigned int isFlipped);
-void clearColor(int red, int green, int blue, unsigned char* data);
-void setPixel(float red, float green, float blue, int x, int y, unsigned char* data);
-void drawLine(int red, int green, int blue, vec3 start, vec3 end, unsigned char* data);
+typedef struct {
+	vec3 eye;
+	vec3 target;
+}cameraPathPoint;
+
+// everything the render loop needs, displayBuffer is NULL when headless
+typedef struct {
+	int isHeadless;
+	int numOfFrames;
+	int shadingMode;
+	int outputFormat;
+	int isNumberedOutput;
+	ImageWriter* imageWriter;
+	TripleBuffer* displayBuffer;
+	cameraPathPoint* cameraPath;
+	int numOfCameraPathPoints;
+	size_t numOfTriangles;
+	vertexBufferData* frameTriangles;
+	Texture* texture;
+	Texture* textureNormal;
+	Sampler sampler; // filter of the diffuse texture
+}renderJob;
+
+void clearDepthBuffer(float zValue, Framebuffer* framebuffer);
+void clearColor(int red, int green, int blue, Framebuffer* framebuffer);
+void setPixel(float red, float green, float blue, int x, int y, Framebuffer* framebuffer);
+void setPixelSamples(float red, float green, float blue, int x, int y, int coverage, Framebuffer* framebuffer);
+void drawLine(int red, int green, int blue, vec3 start, vec3 end, Framebuffer* framebuffer);
 void drawTriangle(vertexBufferData triangleData,
-	unsigned char* texture, unsigned char* textureNormal,
-	float* depthBuffer, unsigned char* data, int mode);
-void setViewPort(vec3 point, ivec2 screenPoint);
+	Texture* texture, Texture* textureNormal, Sampler* sampler,
+	Framebuffer* framebuffer, int mode);
+void shadeFragment(vertexBufferData* triangleData, vec3 bc_screen,
+	vec2 dTextureCoordDx, vec2 dTextureCoordDy,
+	Texture* texture, Texture* textureNormal, Sampler* sampler, vec3 color);
+void clearVisibilityBuffer(Framebuffer* framebuffer);
+void drawTriangleVisibility(vertexBufferData* triangleData, int triangleId,
+	Framebuffer* framebuffer);
+void shadeVisibilityBuffer(vertexBufferData* triangles, Framebuffer* framebuffer,
+	Texture* texture, Texture* textureNormal, Sampler* sampler);
+void setViewPort(vec3 point, ivec2 screenPoint, Framebuffer* framebuffer);
 int isInNDC(vec3 point);
 void Barycentric(ivec2 p, ivec2 a, ivec2 b, ivec2 c, vec3 barycentricCoords);
-void getTextureColor(vec2 textCoord, int textureWidth, int textureHeight, int numOfChannels,
-	unsigned char* texture, float* r, float* g, float* b);
+void BarycentricSample(vec2 p, ivec2 a, ivec2 b, ivec2 c, vec3 barycentricCoords);
+int rasterizeSamples(vertexBufferData* triangleData, ivec2 pixel,
+	ivec2 screenP1, ivec2 screenP2, ivec2 screenP3, const depthPlane* plane,
+	Framebuffer* framebuffer, vec3 sampleCoords[MAX_SAMPLES]);
 bool checkTriangle(ivec2 p1, ivec2 p2, ivec2 p3);
 void vertexShader(vec3 vertexPos, vec3 outputPos, mat4 model, mat4 view, mat4 projection);
+void calculateTextureCoordDerivatives(ivec2 p1, ivec2 p2, ivec2 p3,
+	vec2 textureCoord1, vec2 textureCoord2, vec2 textureCoord3, vec2 dTextureCoordDx, vec2 dTextureCoordDy);
+cameraPathPoint* loadCameraPath(const char* filename, int* numOfPoints);
+int isRendering(TripleBuffer* displayBuffer, int frameNumber, int numOfFrames);
+double getFrameTime(int isHeadless, int frameNumber);
+void renderFrames(void* arg);
 void calculateTBN(mat4 model, vec3 tangent, vec3 normal);
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include "mappedFile.h"
+
+#ifdef _WIN64
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+void* mapFile(const char* filename, size_t* size)
+{
+#ifdef _WIN64
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE fileMapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!fileMapping)
+		return NULL;
+
+	// the view keeps the mapping alive after the handle is closed
+	void* data = MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(fileMapping);
+	if (!data)
+		return NULL;
+
+	*size = (size_t)fileSize.QuadPart;
+	return data;
+#else
+	struct stat sb;
+	int fd = open(filename, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+
+	if (fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode) || sb.st_size == 0)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(0, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = (size_t)sb.st_size;
+	return data;
+#endif
+}
+
+void unmapFile(void* data, size_t size)
+{
+	if (!data)
+		return;
+#ifdef _WIN64
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap(data, size);
+#endif
+}
+
+// The temporary file is named after the file it replaces and the process, so
+// concurrent writers of the same file never share a temporary file.
+FILE* createReplacementFile(const char* filename, char* tempFilename, size_t tempFilenameSize)
+{
+#ifdef _WIN64
+	int pid = _getpid();
+#else
+	int pid = (int)getpid();
+#endif
+	int length = snprintf(tempFilename, tempFilenameSize, "%s.tmp.%d", filename, pid);
+	if (length < 0 || (size_t)length >= tempFilenameSize)
+		return NULL;
+	return fopen(tempFilename, "wb");
+}
+
+// Closes the temporary file and moves it over the file it replaces, a failed write
+// leaves the old file untouched. On POSIX processes which mapped the old file keep
+// their mapping. Windows refuses to replace a mapped file, then the old file is kept
+// and the temporary file deleted.
+int commitReplacementFile(FILE* file, const char* tempFilename, const char* filename, int isWritten)
+{
+	isWritten = fflush(file) == 0 && isWritten;
+	isWritten = fclose(file) == 0 && isWritten;
+#ifdef _WIN64
+	isWritten = isWritten && MoveFileExA(tempFilename, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+	isWritten = isWritten && rename(tempFilename, filename) == 0;
+#endif
+	if (!isWritten)
+		remove(tempFilename);
+	return isWritten;
+}
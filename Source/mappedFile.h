@@ -0,0 +1,11 @@
+#pragma once
+#include <stddef.h>
+#include <stdio.h>
+
+// read-only memory mapping of a whole file
+void* mapFile(const char* filename, size_t* size);
+void unmapFile(void* data, size_t size);
+
+// atomic replacement of files which other processes may have mapped
+FILE* createReplacementFile(const char* filename, char* tempFilename, size_t tempFilenameSize);
+int commitReplacementFile(FILE* file, const char* tempFilename, const char* filename, int isWritten);
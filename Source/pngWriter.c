@@ -0,0 +1,655 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "commonTypes.h"
+#include "pngWriter.h"
+#include "thread.h"
+#include "stb_image_write.h"
+
+#define DEFLATE_WINDOW_SIZE (32768)
+#define DEFLATE_MIN_MATCH (3)
+#define DEFLATE_MAX_MATCH (258)
+#define DEFLATE_HASH_BITS (15)
+#define DEFLATE_MAX_STORED_BLOCK (65535)
+
+static PNGWriterSettings pngWriterSettings = { 0, PNG_FILTER_ADAPTIVE, 8, 0 };
+static ThreadPool* pngWriterPool;
+static int numOfPNGWriterThreads;
+
+static void createEncoderTables();
+
+// The pool is created here and not on the first encode,
+// encodePNG is called from several threads at once.
+int setPNGWriterSettings(const PNGWriterSettings* settings)
+{
+	destroyPNGWriter();
+	pngWriterSettings = *settings;
+	if (pngWriterSettings.level < 0)
+		pngWriterSettings.level = 0;
+	if (pngWriterSettings.level > 9)
+		pngWriterSettings.level = 9;
+	stbi_write_png_compression_level = MAX(1, pngWriterSettings.level);
+	stbi_write_force_png_filter = pngWriterSettings.filter;
+
+	if (pngWriterSettings.isParallel)
+	{
+		createEncoderTables();
+		numOfPNGWriterThreads = pngWriterSettings.numOfThreads < 1 ? getNumberOfCores() : pngWriterSettings.numOfThreads;
+		pngWriterPool = createThreadPool(numOfPNGWriterThreads);
+		if (!pngWriterPool)
+			return 0;
+	}
+	return 1;
+}
+
+void destroyPNGWriter()
+{
+	if (pngWriterPool)
+		destroyThreadPool(pngWriterPool);
+	pngWriterPool = NULL;
+}
+
+typedef struct
+{
+	unsigned char* data;
+	size_t size;
+	size_t capacity;
+	uint64_t bits;
+	int bitCount;
+	int hasFailed;
+}bitWriter;
+
+static void reserveBytes(bitWriter* writer, size_t count)
+{
+	if (writer->size + count <= writer->capacity || writer->hasFailed)
+		return;
+	size_t capacity = MAX(writer->capacity * 2, writer->size + count);
+	unsigned char* data = realloc(writer->data, capacity);
+	if (!data)
+	{
+		writer->hasFailed = 1;
+		return;
+	}
+	writer->data = data;
+	writer->capacity = capacity;
+}
+
+static void putByte(bitWriter* writer, unsigned char value)
+{
+	reserveBytes(writer, 1);
+	if (!writer->hasFailed)
+		writer->data[writer->size++] = value;
+}
+
+// deflate packs the bits starting at the least significant bit
+static void putBits(bitWriter* writer, unsigned int value, int count)
+{
+	writer->bits |= (uint64_t)value << writer->bitCount;
+	writer->bitCount += count;
+	while (writer->bitCount >= 8)
+	{
+		putByte(writer, (unsigned char)writer->bits);
+		writer->bits >>= 8;
+		writer->bitCount -= 8;
+	}
+}
+
+static void alignToByte(bitWriter* writer)
+{
+	if (writer->bitCount > 0)
+		putBits(writer, 0, 8 - writer->bitCount);
+}
+
+// Fixed huffman codes of the literal/length and distance symbols. The codes
+// are stored starting at their most significant bit, so they are kept reversed.
+static unsigned short symbolCodes[288];
+static unsigned char symbolCodeLengths[288];
+static unsigned char distanceCodes[30];
+static unsigned int crcTable[256];
+
+static unsigned int reverseBits(unsigned int code, int length)
+{
+	unsigned int reversed = 0;
+	for (int i = 0; i < length; i++)
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	return reversed;
+}
+
+// filled by setPNGWriterSettings before any band is encoded
+static void createEncoderTables()
+{
+	for (int symbol = 0; symbol < 288; symbol++)
+	{
+		if (symbol <= 143)
+			symbolCodes[symbol] = reverseBits(0x30 + symbol, symbolCodeLengths[symbol] = 8);
+		else if (symbol <= 255)
+			symbolCodes[symbol] = reverseBits(0x190 + symbol - 144, symbolCodeLengths[symbol] = 9);
+		else if (symbol <= 279)
+			symbolCodes[symbol] = reverseBits(symbol - 256, symbolCodeLengths[symbol] = 7);
+		else
+			symbolCodes[symbol] = reverseBits(0xC0 + symbol - 280, symbolCodeLengths[symbol] = 8);
+	}
+	for (int code = 0; code < 30; code++)
+		distanceCodes[code] = reverseBits(code, 5);
+
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		unsigned int crc = i;
+		for (int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0);
+		crcTable[i] = crc;
+	}
+}
+
+static void putSymbol(bitWriter* writer, int symbol)
+{
+	putBits(writer, symbolCodes[symbol], symbolCodeLengths[symbol]);
+}
+
+static const unsigned short lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const unsigned char lengthExtraBits[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const unsigned short distanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const unsigned char distanceExtraBits[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static void putMatch(bitWriter* writer, int length, int distance)
+{
+	int code = 28;
+	while (lengthBase[code] > length)
+		code--;
+	putSymbol(writer, 257 + code);
+	putBits(writer, length - lengthBase[code], lengthExtraBits[code]);
+
+	code = 29;
+	while (distanceBase[code] > distance)
+		code--;
+	putBits(writer, distanceCodes[code], 5);
+	putBits(writer, distance - distanceBase[code], distanceExtraBits[code]);
+}
+
+static unsigned int hashBytes(const unsigned char* data)
+{
+	unsigned int value = data[0] | (data[1] << 8) | (data[2] << 16);
+	return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+// Deflates data[start, end) as one block with the fixed huffman codes, like
+// stb_image_write. The 32K before start are used as the dictionary so the
+// band compresses as well as inside a single stream.
+static void deflateFixed(bitWriter* writer, const unsigned char* data, size_t start, size_t end,
+	int level, int isLast)
+{
+	static const int maxChainLengths[] = { 0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+	int maxChainLength = maxChainLengths[level];
+	size_t dictionaryStart = start > DEFLATE_WINDOW_SIZE ? start - DEFLATE_WINDOW_SIZE : 0;
+
+	int* head = malloc(sizeof(int) * (1 << DEFLATE_HASH_BITS));
+	int* previous = malloc(sizeof(int) * DEFLATE_WINDOW_SIZE);
+	if (!head || !previous)
+	{
+		free(head);
+		free(previous);
+		writer->hasFailed = 1;
+		return;
+	}
+	// positions are relative to dictionaryStart and fit in an int
+	memset(head, 0xff, sizeof(int) * (1 << DEFLATE_HASH_BITS));
+
+	putBits(writer, isLast, 1);
+	putBits(writer, 1, 2);
+
+	for (size_t i = dictionaryStart; i + DEFLATE_MIN_MATCH <= end && i < start; i++)
+	{
+		unsigned int hash = hashBytes(&data[i]);
+		previous[(i - dictionaryStart) % DEFLATE_WINDOW_SIZE] = head[hash];
+		head[hash] = (int)(i - dictionaryStart);
+	}
+
+	size_t i = start;
+	while (i < end)
+	{
+		int bestLength = 0;
+		size_t bestDistance = 0;
+		if (i + DEFLATE_MIN_MATCH <= end)
+		{
+			size_t maxLength = MIN(end - i, DEFLATE_MAX_MATCH);
+			int candidate = head[hashBytes(&data[i])];
+			for (int chain = 0; chain < maxChainLength && candidate >= 0; chain++)
+			{
+				size_t position = dictionaryStart + candidate;
+				if (i - position > DEFLATE_WINDOW_SIZE)
+					break;
+				size_t length = 0;
+				while (length < maxLength && data[position + length] == data[i + length])
+					length++;
+				if ((int)length > bestLength)
+				{
+					bestLength = (int)length;
+					bestDistance = i - position;
+					if (length == maxLength)
+						break;
+				}
+				int next = previous[candidate % DEFLATE_WINDOW_SIZE];
+				if (next >= candidate)
+					break;
+				candidate = next;
+			}
+		}
+
+		int advance = 1;
+		if (bestLength >= DEFLATE_MIN_MATCH)
+		{
+			putMatch(writer, bestLength, (int)bestDistance);
+			advance = bestLength;
+		}
+		else
+			putSymbol(writer, data[i]);
+
+		for (int j = 0; j < advance; j++, i++)
+		{
+			if (i + DEFLATE_MIN_MATCH > end)
+				continue;
+			unsigned int hash = hashBytes(&data[i]);
+			previous[(i - dictionaryStart) % DEFLATE_WINDOW_SIZE] = head[hash];
+			head[hash] = (int)(i - dictionaryStart);
+		}
+	}
+	putSymbol(writer, 256);
+
+	// An empty stored block ends the band on a byte boundary,
+	// so the next band can be appended as it is.
+	if (!isLast)
+	{
+		putBits(writer, 0, 3);
+		alignToByte(writer);
+		putBits(writer, 0x0000, 16);
+		putBits(writer, 0xFFFF, 16);
+	}
+	alignToByte(writer);
+	free(head);
+	free(previous);
+}
+
+// level 0, stored blocks are byte aligned and can be appended as they are
+static void deflateStored(bitWriter* writer, const unsigned char* data, size_t start, size_t end, int isLast)
+{
+	do
+	{
+		size_t length = MIN(end - start, DEFLATE_MAX_STORED_BLOCK);
+		putBits(writer, isLast && start + length == end, 1);
+		putBits(writer, 0, 2);
+		alignToByte(writer);
+		putBits(writer, (unsigned int)length, 16);
+		putBits(writer, (unsigned int)length ^ 0xFFFF, 16);
+		reserveBytes(writer, length);
+		if (writer->hasFailed)
+			return;
+		memcpy(&writer->data[writer->size], &data[start], length);
+		writer->size += length;
+		start += length;
+	} while (start < end);
+}
+
+#define ADLER_BASE (65521)
+
+static unsigned int adler32(const unsigned char* data, size_t size)
+{
+	unsigned int a = 1, b = 0;
+	while (size > 0)
+	{
+		// the sums do not overflow for 5552 bytes
+		size_t count = MIN(size, 5552);
+		for (size_t i = 0; i < count; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= ADLER_BASE;
+		b %= ADLER_BASE;
+		data += count;
+		size -= count;
+	}
+	return (b << 16) | a;
+}
+
+// adler32 of two concatenated blocks, size2 is the size of the second one
+static unsigned int combineAdler32(unsigned int adler1, unsigned int adler2, size_t size2)
+{
+	unsigned int remainder = (unsigned int)(size2 % ADLER_BASE);
+	unsigned int a1 = adler1 & 0xFFFF, b1 = adler1 >> 16;
+	unsigned int a2 = adler2 & 0xFFFF, b2 = adler2 >> 16;
+	unsigned int a = (a1 + a2 + ADLER_BASE - 1) % ADLER_BASE;
+	unsigned int b = (unsigned int)(((uint64_t)remainder * a1 + b1 + b2 + ADLER_BASE - remainder) % ADLER_BASE);
+	return (b << 16) | a;
+}
+
+static unsigned int updateCrc32(unsigned int crc, const unsigned char* data, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+static int paethPredictor(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return a;
+	return pb <= pc ? b : c;
+}
+
+// previousRow is NULL for the first row of the image
+static void filterRow(unsigned char* output, const unsigned char* row, const unsigned char* previousRow,
+	int rowSize, int comp, int filter)
+{
+	output[0] = (unsigned char)filter;
+	for (int i = 0; i < rowSize; i++)
+	{
+		int left = i >= comp ? row[i - comp] : 0;
+		int up = previousRow ? previousRow[i] : 0;
+		int upLeft = previousRow && i >= comp ? previousRow[i - comp] : 0;
+		int prediction = 0;
+		switch (filter)
+		{
+		case PNG_FILTER_SUB:
+			prediction = left;
+			break;
+		case PNG_FILTER_UP:
+			prediction = up;
+			break;
+		case PNG_FILTER_AVERAGE:
+			prediction = (left + up) >> 1;
+			break;
+		case PNG_FILTER_PAETH:
+			prediction = paethPredictor(left, up, upLeft);
+			break;
+		}
+		output[i + 1] = (unsigned char)(row[i] - prediction);
+	}
+}
+
+// the smallest sum of the filtered bytes as signed values tends to compress best
+static void filterRowAdaptive(unsigned char* output, unsigned char* scratch, const unsigned char* row,
+	const unsigned char* previousRow, int rowSize, int comp)
+{
+	int bestSum = -1;
+	for (int filter = PNG_FILTER_NONE; filter <= PNG_FILTER_PAETH; filter++)
+	{
+		filterRow(scratch, row, previousRow, rowSize, comp, filter);
+		int sum = 0;
+		for (int i = 1; i <= rowSize; i++)
+			sum += abs((signed char)scratch[i]);
+		if (bestSum < 0 || sum < bestSum)
+		{
+			bestSum = sum;
+			memcpy(output, scratch, (size_t)rowSize + 1);
+		}
+	}
+}
+
+typedef struct
+{
+	Mutex* mutex;
+	Condition* condition;
+	int numOfJobs;
+}jobGroup;
+
+typedef struct
+{
+	// shared by all bands
+	const unsigned char* data;
+	ptrdiff_t stride; // negative for flipped images
+	int rowSize;
+	int comp;
+	unsigned char* filtered;
+	jobGroup* group;
+	// rows of the band
+	int firstRow;
+	int numOfRows;
+	int isLast;
+	bitWriter output;
+	unsigned int adler;
+}pngBand;
+
+static void finishJob(jobGroup* group)
+{
+	lockMutex(group->mutex);
+	if (--group->numOfJobs == 0)
+		broadcastCondition(group->condition);
+	unlockMutex(group->mutex);
+}
+
+static void filterBand(void* arg)
+{
+	pngBand* band = (pngBand*)arg;
+	int filteredRowSize = band->rowSize + 1;
+	unsigned char* scratch = malloc(filteredRowSize);
+	for (int y = band->firstRow; y < band->firstRow + band->numOfRows; y++)
+	{
+		const unsigned char* row = band->data + y * band->stride;
+		const unsigned char* previousRow = y > 0 ? row - band->stride : NULL;
+		unsigned char* output = &band->filtered[(size_t)y * filteredRowSize];
+		if (pngWriterSettings.filter == PNG_FILTER_ADAPTIVE && scratch)
+			filterRowAdaptive(output, scratch, row, previousRow, band->rowSize, band->comp);
+		else
+			filterRow(output, row, previousRow, band->rowSize, band->comp,
+				pngWriterSettings.filter == PNG_FILTER_ADAPTIVE ? PNG_FILTER_PAETH : pngWriterSettings.filter);
+	}
+	free(scratch);
+	band->adler = adler32(&band->filtered[(size_t)band->firstRow * filteredRowSize],
+		(size_t)band->numOfRows * filteredRowSize);
+	finishJob(band->group);
+}
+
+static void deflateBand(void* arg)
+{
+	pngBand* band = (pngBand*)arg;
+	size_t filteredRowSize = (size_t)band->rowSize + 1;
+	size_t start = band->firstRow * filteredRowSize;
+	size_t end = start + band->numOfRows * filteredRowSize;
+
+	// fixed huffman codes take at most 9 bits per byte
+	reserveBytes(&band->output, (end - start) / 8 * 9 + 64);
+	if (pngWriterSettings.level == 0)
+		deflateStored(&band->output, band->filtered, start, end, band->isLast);
+	else
+		deflateFixed(&band->output, band->filtered, start, end, pngWriterSettings.level, band->isLast);
+	finishJob(band->group);
+}
+
+// runs function on every band and waits for all of them
+static void runBandJobs(jobGroup* group, pngBand* bands, int numOfBands, threadFunction function)
+{
+	group->numOfJobs = numOfBands;
+	for (int i = 0; i < numOfBands; i++)
+		submitJob(pngWriterPool, function, &bands[i]);
+
+	lockMutex(group->mutex);
+	while (group->numOfJobs > 0)
+		waitCondition(group->condition, group->mutex);
+	unlockMutex(group->mutex);
+}
+
+static void putChunkStart(bitWriter* writer, size_t size, const char* type)
+{
+	putByte(writer, (unsigned char)(size >> 24));
+	putByte(writer, (unsigned char)(size >> 16));
+	putByte(writer, (unsigned char)(size >> 8));
+	putByte(writer, (unsigned char)size);
+	for (int i = 0; i < 4; i++)
+		putByte(writer, type[i]);
+}
+
+// the crc covers the chunk type and data, which start 4 bytes after chunkStart
+static void putChunkEnd(bitWriter* writer, size_t chunkStart)
+{
+	if (writer->hasFailed)
+		return;
+	unsigned int crc = ~updateCrc32(0xFFFFFFFFu, &writer->data[chunkStart + 4], writer->size - chunkStart - 4);
+	putByte(writer, (unsigned char)(crc >> 24));
+	putByte(writer, (unsigned char)(crc >> 16));
+	putByte(writer, (unsigned char)(crc >> 8));
+	putByte(writer, (unsigned char)crc);
+}
+
+// PNG container around the stitched zlib stream of the bands
+static void writePNG(bitWriter* png, int width, int height, int comp, pngBand* bands, int numOfBands)
+{
+	static const unsigned char colorTypes[] = { 0, 0, 4, 2, 6 };
+	static const unsigned char signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+	size_t zlibSize = 2 + 4;
+	unsigned int adler = bands[0].adler;
+	for (int i = 0; i < numOfBands; i++)
+	{
+		if (bands[i].output.hasFailed)
+			png->hasFailed = 1;
+		zlibSize += bands[i].output.size;
+		if (i > 0)
+			adler = combineAdler32(adler, bands[i].adler, (size_t)bands[i].numOfRows * (bands[i].rowSize + 1));
+	}
+
+	reserveBytes(png, sizeof(signature) + 25 + zlibSize + 12 + 12);
+	if (png->hasFailed)
+		return;
+	for (int i = 0; i < (int)sizeof(signature); i++)
+		putByte(png, signature[i]);
+
+	size_t chunkStart = png->size;
+	putChunkStart(png, 13, "IHDR");
+	unsigned char header[] = { (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8),
+		(unsigned char)width, (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8),
+		(unsigned char)height, 8, colorTypes[comp], 0, 0, 0 };
+	for (int i = 0; i < (int)sizeof(header); i++)
+		putByte(png, header[i]);
+	putChunkEnd(png, chunkStart);
+
+	// zlib header, deflate with a 32K window
+	chunkStart = png->size;
+	putChunkStart(png, zlibSize, "IDAT");
+	putByte(png, 0x78);
+	putByte(png, 0x5E);
+	for (int i = 0; i < numOfBands; i++)
+	{
+		memcpy(&png->data[png->size], bands[i].output.data, bands[i].output.size);
+		png->size += bands[i].output.size;
+	}
+	putByte(png, (unsigned char)(adler >> 24));
+	putByte(png, (unsigned char)(adler >> 16));
+	putByte(png, (unsigned char)(adler >> 8));
+	putByte(png, (unsigned char)adler);
+	putChunkEnd(png, chunkStart);
+
+	chunkStart = png->size;
+	putChunkStart(png, 0, "IEND");
+	putChunkEnd(png, chunkStart);
+}
+
+static unsigned char* encodePNGParallel(const unsigned char* data, int width, int height, int comp,
+	ptrdiff_t stride, int* size)
+{
+	int rowSize = width * comp;
+	size_t filteredSize = (size_t)height * (rowSize + 1);
+	int numOfBands = (int)MIN(filteredSize / PNG_MIN_BAND_SIZE + 1, (size_t)MIN(height, numOfPNGWriterThreads));
+
+	unsigned char* filtered = malloc(filteredSize);
+	pngBand* bands = calloc(numOfBands, sizeof(pngBand));
+	jobGroup group = { createMutex(), createCondition(), 0 };
+	bitWriter png = { 0 };
+	if (filtered && bands && group.mutex && group.condition)
+	{
+		for (int i = 0; i < numOfBands; i++)
+		{
+			pngBand* band = &bands[i];
+			band->data = data;
+			band->stride = stride;
+			band->rowSize = rowSize;
+			band->comp = comp;
+			band->filtered = filtered;
+			band->group = &group;
+			band->firstRow = (int)((long long)height * i / numOfBands);
+			band->numOfRows = (int)((long long)height * (i + 1) / numOfBands) - band->firstRow;
+			band->isLast = i == numOfBands - 1;
+		}
+		// bands use the end of the previous band as their dictionary, so all rows are filtered first
+		runBandJobs(&group, bands, numOfBands, filterBand);
+		runBandJobs(&group, bands, numOfBands, deflateBand);
+		writePNG(&png, width, height, comp, bands, numOfBands);
+	}
+	else
+		png.hasFailed = 1;
+
+	for (int i = 0; bands && i < numOfBands; i++)
+		free(bands[i].output.data);
+	if (group.condition)
+		destroyCondition(group.condition);
+	if (group.mutex)
+		destroyMutex(group.mutex);
+	free(bands);
+	free(filtered);
+	if (png.hasFailed)
+	{
+		free(png.data);
+		return NULL;
+	}
+	*size = (int)png.size;
+	return png.data;
+}
+
+typedef struct
+{
+	unsigned char* data;
+	int size;
+	int hasFailed;
+}encodedImage;
+
+// stb calls it once with the whole encoded image, a failed allocation fails the
+// whole encode so a truncated image is never written
+static void writeToMemory(void* context, void* data, int size)
+{
+	encodedImage* image = (encodedImage*)context;
+	if (image->hasFailed)
+		return;
+	unsigned char* grown = realloc(image->data, (size_t)image->size + size);
+	if (!grown)
+	{
+		image->hasFailed = 1;
+		return;
+	}
+	memcpy(grown + image->size, data, size);
+	image->data = grown;
+	image->size += size;
+}
+
+// Flipping is done with a negative stride instead of stbi_flip_vertically_on_write,
+// which is a global and would race between the encoder threads.
+unsigned char* encodePNG(const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int* size)
+{
+	if (comp < 1 || comp > 4)
+		return NULL;
+	if (stride == 0)
+		stride = width * comp;
+	if (isFlipped)
+	{
+		data += (size_t)stride * (height - 1);
+		stride = -stride;
+	}
+
+	if (pngWriterSettings.isParallel && pngWriterPool)
+		return encodePNGParallel(data, width, height, comp, stride, size);
+
+	encodedImage image = { NULL, 0, 0 };
+	if (!stbi_write_png_to_func(writeToMemory, &image, width, height, comp, data, stride) || image.hasFailed)
+	{
+		free(image.data);
+		return NULL;
+	}
+	*size = image.size;
+	return image.data;
+}
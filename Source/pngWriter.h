@@ -0,0 +1,24 @@
+#pragma once
+
+#define PNG_MIN_BAND_SIZE (64 * 1024) // smaller bands lose too much compression at the band borders
+
+// row filters, PNG_FILTER_ADAPTIVE picks the filter with the smallest output per row
+enum pngFilter { PNG_FILTER_ADAPTIVE = -1, PNG_FILTER_NONE = 0, PNG_FILTER_SUB = 1, PNG_FILTER_UP = 2,
+	PNG_FILTER_AVERAGE = 3, PNG_FILTER_PAETH = 4 };
+
+// With isParallel the image is split into row bands which are filtered and
+// deflated independently on numOfThreads threads, then stitched into one
+// zlib stream. Otherwise stb_image_write encodes it on the calling thread.
+typedef struct
+{
+	int isParallel;
+	int filter;
+	int level; // 0 stores the data uncompressed, up to 9 searches longer for matches
+	int numOfThreads; // < 1 uses all cores
+}PNGWriterSettings;
+
+int setPNGWriterSettings(const PNGWriterSettings* settings);
+void destroyPNGWriter();
+// the encoded PNG is released with free
+unsigned char* encodePNG(const unsigned char* data, int width, int height, int comp,
+	int stride, unsigned int isFlipped, int* size);
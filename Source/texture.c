@@ -0,0 +1,613 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "texture.h"
+#include "thread.h"
+#include "mappedFile.h"
+#include "stb_image.h"
+
+// Converts an RGB(A) tangent space normal map to a two-channel (RG8) texture.
+// Tangent space normals always point out of the surface (z >= 0), so z can be
+// reconstructed from x and y and does not need to be stored.
+unsigned char* createTwoChannelNormalMap(unsigned char* normalMap, int width, int height, int numOfChannels)
+{
+	if (!normalMap || numOfChannels < NORMAL_MAP_CHANNELS)
+		return NULL;
+
+	unsigned char* twoChannelMap = malloc((size_t)width * height * NORMAL_MAP_CHANNELS);
+	if (!twoChannelMap)
+		return NULL;
+
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		twoChannelMap[i * NORMAL_MAP_CHANNELS] = normalMap[i * numOfChannels];
+		twoChannelMap[i * NORMAL_MAP_CHANNELS + 1] = normalMap[i * numOfChannels + 1];
+	}
+	return twoChannelMap;
+}
+
+// gets barycentric texture coord and returns the color of the pixel([0,1]) 
+// that corresponds to the texture coord
+void getTextureColor(vec2 textCoord, int textureWidth, int textureHeight, int numOfChannels,
+	unsigned char* texture, float* r, float* g, float* b)
+{
+	ivec2 texturePixels;
+	texturePixels[0] = textCoord[0] * textureWidth;
+	texturePixels[1] = fabs(textCoord[1] - 1.0f) * textureHeight;
+
+	*r = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels]) / 255.0f;
+	*g = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels + 1]) / 255.0f;
+	*b = (float)(texture[texturePixels[1] * textureWidth * numOfChannels + texturePixels[0] * numOfChannels + 2]) / 255.0f;
+}
+
+// gets barycentric texture coord and returns the tangent space normal([-1,1])
+// stored in a two-channel normal map, z is reconstructed from x and y
+void getTextureNormal(vec2 textCoord, int textureWidth, int textureHeight,
+	unsigned char* texture, vec3 normal)
+{
+	ivec2 texturePixels;
+	texturePixels[0] = textCoord[0] * textureWidth;
+	texturePixels[1] = fabs(textCoord[1] - 1.0f) * textureHeight;
+
+	unsigned char* texel = &texture[(texturePixels[1] * textureWidth + texturePixels[0]) * NORMAL_MAP_CHANNELS];
+	normal[0] = (float)texel[0] / 255.0f * 2.0f - 1.0f; //normalize normal vector to [-1, 1]
+	normal[1] = (float)texel[1] / 255.0f * 2.0f - 1.0f;
+
+	// quantized x and y can be slightly longer than 1, those normals are clamped
+	// to the tangent plane and renormalized so the result is always unit length
+	float zSquared = 1.0f - normal[0] * normal[0] - normal[1] * normal[1];
+	if (zSquared >= 0.0f)
+		normal[2] = sqrtf(zSquared);
+	else
+	{
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1]);
+		normal[0] /= length;
+		normal[1] /= length;
+		normal[2] = 0.0f;
+	}
+}
+// bilinear fetch from one mip level, the texture coordinates are clamped to the edges
+static void getMipColor(Texture* texture, int level, float u, float v, float* color)
+{
+	int width = getMipWidth(texture, level);
+	int height = getMipHeight(texture, level);
+	int channels = texture->numOfChannels;
+	unsigned char* mip = texture->mips[level];
+
+	float x = u * width - 0.5f;
+	float y = (1.0f - v) * height - 0.5f;
+	x = fminf(fmaxf(x, 0.0f), (float)(width - 1));
+	y = fminf(fmaxf(y, 0.0f), (float)(height - 1));
+
+	int x0 = (int)x;
+	int y0 = (int)y;
+	int x1 = MIN(x0 + 1, width - 1);
+	int y1 = MIN(y0 + 1, height - 1);
+	float fx = x - x0;
+	float fy = y - y0;
+
+	for (int c = 0; c < 3; c++)
+	{
+		float top = mip[(y0 * width + x0) * channels + c] * (1.0f - fx) + mip[(y0 * width + x1) * channels + c] * fx;
+		float bottom = mip[(y1 * width + x0) * channels + c] * (1.0f - fx) + mip[(y1 * width + x1) * channels + c] * fx;
+		color[c] = (top * (1.0f - fy) + bottom * fy) / 255.0f;
+	}
+}
+
+// Samples the texture with the footprint of the pixel in texture space.
+// The footprint is given by the derivatives of the texture coord along the
+// screen x and y axes. Taps are spread along the major axis of the footprint,
+// their count is the anisotropy ratio bounded by the tap budget of the sampler,
+// and the mip level is chosen from the footprint length covered by each tap.
+void sampleTexture(Texture* texture, Sampler* sampler, vec2 textCoord,
+	vec2 dTextCoordDx, vec2 dTextCoordDy, float* r, float* g, float* b)
+{
+	if (!sampler || sampler->filter == FILTER_NEAREST || texture->mipCount == 0)
+	{
+		getTextureColor(textCoord, texture->width, texture->height, texture->numOfChannels,
+			texture->data, r, g, b);
+		return;
+	}
+
+	// footprint axes in texels
+	float dxU = dTextCoordDx[0] * texture->width, dxV = dTextCoordDx[1] * texture->height;
+	float dyU = dTextCoordDy[0] * texture->width, dyV = dTextCoordDy[1] * texture->height;
+	float lengthX = sqrtf(dxU * dxU + dxV * dxV);
+	float lengthY = sqrtf(dyU * dyU + dyV * dyV);
+	float majorLength = fmaxf(lengthX, lengthY);
+	float minorLength = fminf(lengthX, lengthY);
+	float* majorAxis = lengthX >= lengthY ? dTextCoordDx : dTextCoordDy;
+
+	int numOfTaps = 1;
+	if (minorLength > 0.0f)
+		numOfTaps = (int)ceilf(majorLength / minorLength);
+	else if (majorLength > 0.0f)
+		numOfTaps = sampler->maxAnisotropicTaps;
+	numOfTaps = MAX(1, MIN(numOfTaps, sampler->maxAnisotropicTaps));
+
+	float tapLength = majorLength / numOfTaps;
+	int level = tapLength > 1.0f ? (int)(log2f(tapLength) + 0.5f) : 0;
+	level = MIN(level, texture->mipCount - 1);
+
+	float color[3], sum[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < numOfTaps; i++)
+	{
+		float offset = (i + 0.5f) / numOfTaps - 0.5f;
+		getMipColor(texture, level,
+			textCoord[0] + majorAxis[0] * offset,
+			textCoord[1] + majorAxis[1] * offset, color);
+		sum[0] += color[0];
+		sum[1] += color[1];
+		sum[2] += color[2];
+	}
+	*r = sum[0] / numOfTaps;
+	*g = sum[1] / numOfTaps;
+	*b = sum[2] / numOfTaps;
+}
+
+// PREPROCESSED TEXTURE FILES
+// A decoded texture is stored next to its source image as a raw, mip-mapped
+// file which is memory mapped on later runs instead of decoding the source.
+// The file is rebuilt when the size or modification time of the source changes.
+typedef struct
+{
+	char magic[4];
+	unsigned int version;
+	int type;
+	int width;
+	int height;
+	int numOfChannels;
+	int mipCount;
+	int reserved;
+	long long sourceSize;
+	long long sourceTime;
+	unsigned long long mipOffsets[TEXTURE_MAX_MIP_LEVELS];
+}TextureFileHeader;
+
+static void getTextureFilePath(const char* path, int type, char* filePath, size_t filePathSize)
+{
+	snprintf(filePath, filePathSize, "%s%s", path,
+		type == TEXTURE_NORMAL_MAP ? TEXTURE_FILE_EXTENSION_NORMAL_MAP : TEXTURE_FILE_EXTENSION);
+}
+
+static int getMipCount(int width, int height)
+{
+	int mipCount = 1;
+	while ((width > 1 || height > 1) && mipCount < TEXTURE_MAX_MIP_LEVELS)
+	{
+		width = MAX(1, width / 2);
+		height = MAX(1, height / 2);
+		mipCount++;
+	}
+	return mipCount;
+}
+
+static size_t getMipSize(Texture* texture, int level)
+{
+	return (size_t)getMipWidth(texture, level) * getMipHeight(texture, level) * texture->numOfChannels;
+}
+
+int getMipWidth(Texture* texture, int level)
+{
+	return MAX(1, texture->width >> level);
+}
+
+int getMipHeight(Texture* texture, int level)
+{
+	return MAX(1, texture->height >> level);
+}
+
+// replaces the level 0 image of the texture with a single allocation holding
+// the whole mip chain, each level is a 2x2 box filter of the previous one
+static int buildMipChain(Texture* texture)
+{
+	int channels = texture->numOfChannels;
+	texture->mipCount = getMipCount(texture->width, texture->height);
+
+	texture->size = 0;
+	for (int level = 0; level < texture->mipCount; level++)
+		texture->size += getMipSize(texture, level);
+
+	unsigned char* chain = malloc(texture->size);
+	if (!chain)
+		return 0;
+
+	memcpy(chain, texture->data, getMipSize(texture, 0));
+	texture->mips[0] = chain;
+	for (int level = 1; level < texture->mipCount; level++)
+	{
+		unsigned char* source = texture->mips[level - 1];
+		int sourceWidth = getMipWidth(texture, level - 1);
+		int sourceHeight = getMipHeight(texture, level - 1);
+		int width = getMipWidth(texture, level);
+		int height = getMipHeight(texture, level);
+
+		texture->mips[level] = texture->mips[level - 1] + getMipSize(texture, level - 1);
+		for (int y = 0; y < height; y++)
+		{
+			int y0 = MIN(y * 2, sourceHeight - 1);
+			int y1 = MIN(y * 2 + 1, sourceHeight - 1);
+			for (int x = 0; x < width; x++)
+			{
+				int x0 = MIN(x * 2, sourceWidth - 1);
+				int x1 = MIN(x * 2 + 1, sourceWidth - 1);
+				for (int c = 0; c < channels; c++)
+				{
+					int sum = source[(y0 * sourceWidth + x0) * channels + c] +
+						source[(y0 * sourceWidth + x1) * channels + c] +
+						source[(y1 * sourceWidth + x0) * channels + c] +
+						source[(y1 * sourceWidth + x1) * channels + c];
+					texture->mips[level][(y * width + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+	}
+
+	free(texture->data);
+	texture->data = chain;
+	return 1;
+}
+
+static int writeTextureFile(Texture* texture, const char* filePath, struct stat* sourceStat)
+{
+	TextureFileHeader header = { 0 };
+	memcpy(header.magic, TEXTURE_FILE_MAGIC, 4);
+	header.version = TEXTURE_FILE_VERSION;
+	header.type = texture->type;
+	header.width = texture->width;
+	header.height = texture->height;
+	header.numOfChannels = texture->numOfChannels;
+	header.mipCount = texture->mipCount;
+	header.sourceSize = (long long)sourceStat->st_size;
+	header.sourceTime = (long long)sourceStat->st_mtime;
+	for (int level = 0; level < texture->mipCount; level++)
+		header.mipOffsets[level] = sizeof(header) + (texture->mips[level] - texture->data);
+
+	// other renderers may have the current file mapped, it is replaced and never rewritten
+	char tempFilePath[1024];
+	FILE* file = createReplacementFile(filePath, tempFilePath, sizeof(tempFilePath));
+	if (!file)
+		return 0;
+
+	int isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(texture->data, texture->size, 1, file) == 1;
+	return commitReplacementFile(file, tempFilePath, filePath, isWritten);
+}
+
+static Texture* mapTextureFile(const char* path, int type, const char* filePath, struct stat* sourceStat)
+{
+	size_t fileSize = 0;
+	unsigned char* file = mapFile(filePath, &fileSize);
+	if (!file)
+		return NULL;
+
+	TextureFileHeader* header = (TextureFileHeader*)file;
+	int isValid = fileSize >= sizeof(TextureFileHeader) &&
+		memcmp(header->magic, TEXTURE_FILE_MAGIC, 4) == 0 &&
+		header->version == TEXTURE_FILE_VERSION &&
+		header->type == type &&
+		header->mipCount > 0 && header->mipCount <= TEXTURE_MAX_MIP_LEVELS &&
+		header->numOfChannels > 0 && header->numOfChannels <= 4 &&
+		// bounded by the mapped size before any mip size is computed from them
+		header->width > 0 && header->height > 0 &&
+		(unsigned long long)header->width * header->height * header->numOfChannels <= fileSize &&
+		header->sourceSize == (long long)sourceStat->st_size &&
+		header->sourceTime == (long long)sourceStat->st_mtime;
+
+	Texture* texture = isValid ? calloc(1, sizeof(Texture)) : NULL;
+	if (texture)
+	{
+		texture->type = type;
+		texture->width = header->width;
+		texture->height = header->height;
+		texture->numOfChannels = header->numOfChannels;
+		texture->mipCount = header->mipCount;
+		for (int level = 0; level < texture->mipCount && isValid; level++)
+		{
+			isValid = header->mipOffsets[level] <= fileSize &&
+				getMipSize(texture, level) <= fileSize - header->mipOffsets[level];
+			texture->mips[level] = file + header->mipOffsets[level];
+			texture->size += getMipSize(texture, level);
+		}
+	}
+
+	if (!isValid)
+	{
+		free(texture);
+		unmapFile(file, fileSize);
+		return NULL;
+	}
+
+	texture->path = malloc(strlen(path) + 1);
+	if (!texture->path)
+	{
+		free(texture);
+		unmapFile(file, fileSize);
+		return NULL;
+	}
+	strcpy(texture->path, path);
+	texture->data = texture->mips[0];
+	texture->mappedFile = file;
+	texture->mappedSize = fileSize;
+	return texture;
+}
+
+static void freeTexture(Texture* texture)
+{
+	if (texture->mappedFile)
+		unmapFile(texture->mappedFile, texture->mappedSize);
+	else
+		free(texture->data);
+	free(texture->path);
+	free(texture);
+}
+
+static Texture* decodeTexture(const char* path, int type)
+{
+	Texture* texture = calloc(1, sizeof(Texture));
+	if (!texture)
+		return NULL;
+
+	texture->data = stbi_load(path, &texture->width, &texture->height, &texture->numOfChannels, 0);
+	if (!texture->data)
+	{
+		fprintf(stderr, "Failed to load texture %s\n", path);
+		free(texture);
+		return NULL;
+	}
+
+	if (type == TEXTURE_NORMAL_MAP)
+	{
+		unsigned char* twoChannelMap = createTwoChannelNormalMap(texture->data,
+			texture->width, texture->height, texture->numOfChannels);
+		stbi_image_free(texture->data);
+		texture->data = twoChannelMap;
+		texture->numOfChannels = NORMAL_MAP_CHANNELS;
+	}
+
+	texture->type = type;
+	if (!texture->data || !buildMipChain(texture))
+	{
+		free(texture->data);
+		free(texture);
+		return NULL;
+	}
+
+	texture->path = malloc(strlen(path) + 1);
+	if (!texture->path)
+	{
+		free(texture->data);
+		free(texture);
+		return NULL;
+	}
+	strcpy(texture->path, path);
+	return texture;
+}
+
+// maps the preprocessed file of the texture when it is up to date, otherwise
+// decodes the source image and writes the preprocessed file for the next run
+static Texture* loadTexture(const char* path, int type)
+{
+	char filePath[1024];
+	struct stat sourceStat;
+	if (stat(path, &sourceStat) != 0)
+	{
+		fprintf(stderr, "Failed to load texture %s\n", path);
+		return NULL;
+	}
+
+	getTextureFilePath(path, type, filePath, sizeof(filePath));
+	Texture* texture = mapTextureFile(path, type, filePath, &sourceStat);
+	if (texture)
+		return texture;
+
+	texture = decodeTexture(path, type);
+	if (texture)
+		writeTextureFile(texture, filePath, &sourceStat);
+	return texture;
+}
+
+// converts the source image to the preprocessed format ahead of time
+int preprocessTexture(const char* path, int type)
+{
+	Texture* texture = loadTexture(path, type);
+	if (!texture)
+		return 0;
+
+	freeTexture(texture);
+	return 1;
+}
+
+// TEXTURE REGISTRY
+// Every image is decoded once and shared by all meshes using the same path.
+// Textures are reference counted, unused ones stay cached until the memory
+// budget is exceeded and then they are evicted, least recently used first.
+static Texture** registry;
+static size_t registryCount, registryCapacity;
+static size_t registryMemory;
+static size_t registryBudget = DEFAULT_TEXTURE_MEMORY_BUDGET;
+static unsigned int registryClock;
+
+static void evictUnusedTextures()
+{
+	while (registryMemory > registryBudget)
+	{
+		size_t lru = registryCount;
+		for (size_t i = 0; i < registryCount; i++)
+		{
+			if (registry[i]->refCount == 0 &&
+				(lru == registryCount || registry[i]->lastUsed < registry[lru]->lastUsed))
+				lru = i;
+		}
+		if (lru == registryCount)
+			return; // every texture is in use
+
+		registryMemory -= registry[lru]->size;
+		freeTexture(registry[lru]);
+		registry[lru] = registry[--registryCount];
+	}
+}
+
+static Texture* findTexture(const char* path, int type)
+{
+	for (size_t i = 0; i < registryCount; i++)
+	{
+		if (registry[i]->type == type && strcmp(registry[i]->path, path) == 0)
+			return registry[i];
+	}
+	return NULL;
+}
+
+static Texture* registerTexture(Texture* texture)
+{
+	if (registryCount == registryCapacity)
+	{
+		size_t capacity = registryCapacity ? registryCapacity * 2 : 16;
+		Texture** grown = realloc(registry, capacity * sizeof(Texture*));
+		if (!grown)
+		{
+			freeTexture(texture);
+			return NULL;
+		}
+		registry = grown;
+		registryCapacity = capacity;
+	}
+
+	texture->refCount = 1;
+	texture->lastUsed = ++registryClock;
+	registry[registryCount++] = texture;
+	registryMemory += texture->size;
+	evictUnusedTextures();
+	return texture;
+}
+
+Texture* acquireTexture(const char* path, int type)
+{
+	Texture* texture = findTexture(path, type);
+	if (texture)
+	{
+		texture->refCount++;
+		texture->lastUsed = ++registryClock;
+		return texture;
+	}
+
+	texture = loadTexture(path, type);
+	if (!texture)
+		return NULL;
+	return registerTexture(texture);
+}
+
+typedef struct
+{
+	const char* path;
+	int type;
+	Texture* texture;
+	int isFailed;
+}TextureLoadJob;
+
+static void textureLoadJob(void* arg)
+{
+	TextureLoadJob* job = (TextureLoadJob*)arg;
+	job->texture = loadTexture(job->path, job->type);
+}
+
+// Acquires several textures at once. Textures which are not in the registry
+// are loaded in parallel on a thread pool, then registered on the calling thread.
+// Returns the number of textures that could not be loaded.
+int acquireTextures(const char** paths, const int* types, int count, Texture** textures)
+{
+	TextureLoadJob* jobs = calloc(count, sizeof(TextureLoadJob));
+	ThreadPool* pool = NULL;
+	int numOfFailures = 0;
+	if (!jobs)
+	{
+		for (int i = 0; i < count; i++)
+			textures[i] = NULL;
+		return count;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		textures[i] = findTexture(paths[i], types[i]);
+		if (textures[i])
+			continue;
+
+		// the same texture may be requested twice in one batch
+		int isQueued = 0;
+		for (int j = 0; j < i && !isQueued; j++)
+			isQueued = jobs[j].path && jobs[j].type == types[i] && strcmp(jobs[j].path, paths[i]) == 0;
+		if (isQueued)
+			continue;
+
+		if (!pool)
+			pool = createThreadPool(MIN(count, getNumberOfCores()));
+		jobs[i].path = paths[i];
+		jobs[i].type = types[i];
+		submitJob(pool, textureLoadJob, &jobs[i]);
+	}
+	destroyThreadPool(pool);
+
+	for (int i = 0; i < count; i++)
+	{
+		if (jobs[i].texture)
+			jobs[i].texture = registerTexture(jobs[i].texture);
+		jobs[i].isFailed = jobs[i].path && !jobs[i].texture;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		// textures which failed to load in the batch are not loaded a second time
+		int isFailed = 0;
+		for (int j = 0; j <= i && !isFailed; j++)
+			isFailed = jobs[j].isFailed && jobs[j].type == types[i] && strcmp(jobs[j].path, paths[i]) == 0;
+		textures[i] = isFailed ? NULL : acquireTexture(paths[i], types[i]);
+		if (!textures[i])
+			numOfFailures++;
+	}
+
+	// drop the reference taken by registering the loaded textures
+	for (int i = 0; i < count; i++)
+	{
+		if (jobs[i].texture)
+			releaseTexture(jobs[i].texture);
+	}
+
+	free(jobs);
+	return numOfFailures;
+}
+
+void releaseTexture(Texture* texture)
+{
+	if (!texture || texture->refCount == 0)
+		return;
+
+	texture->refCount--;
+	texture->lastUsed = ++registryClock;
+	evictUnusedTextures();
+}
+
+void setTextureMemoryBudget(size_t budget)
+{
+	registryBudget = budget;
+	evictUnusedTextures();
+}
+
+size_t getTextureMemoryUsage()
+{
+	return registryMemory;
+}
+
+void destroyTextureRegistry()
+{
+	for (size_t i = 0; i < registryCount; i++)
+	{
+		freeTexture(registry[i]);
+	}
+	free(registry);
+	registry = NULL;
+	registryCount = registryCapacity = 0;
+	registryMemory = 0;
+}
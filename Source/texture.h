@@ -0,0 +1,58 @@
+#pragma once
+#include "commonTypes.h"
+
+#define NORMAL_MAP_CHANNELS (2)
+#define DEFAULT_TEXTURE_MEMORY_BUDGET (256 * 1024 * 1024)
+#define TEXTURE_MAX_MIP_LEVELS (16)
+
+// preprocessed, render-ready texture files written next to the source images
+#define TEXTURE_FILE_MAGIC "RTEX"
+#define TEXTURE_FILE_VERSION (1)
+#define TEXTURE_FILE_EXTENSION ".rtex"
+#define TEXTURE_FILE_EXTENSION_NORMAL_MAP ".nm.rtex"
+
+#define MAX_ANISOTROPIC_TAPS (16)
+
+enum textureType { TEXTURE_COLOR = 0, TEXTURE_NORMAL_MAP = 1 };
+enum textureFilter { FILTER_NEAREST = 0, FILTER_ANISOTROPIC = 1 };
+
+typedef struct
+{
+	int filter;
+	int maxAnisotropicTaps; // tap budget of the anisotropic filter, trades quality for speed
+}Sampler;
+
+typedef struct
+{
+	char* path;
+	int type;
+	unsigned char* data; // mip level 0
+	unsigned char* mips[TEXTURE_MAX_MIP_LEVELS];
+	int mipCount;
+	int width;
+	int height;
+	int numOfChannels;
+	void* mappedFile; // set when the texture is mapped from a preprocessed file
+	size_t mappedSize;
+	size_t size;
+	int refCount;
+	unsigned int lastUsed;
+}Texture;
+
+void getTextureColor(vec2 textCoord, int textureWidth, int textureHeight, int numOfChannels,
+	unsigned char* texture, float* r, float* g, float* b);
+unsigned char* createTwoChannelNormalMap(unsigned char* normalMap, int width, int height, int numOfChannels);
+void getTextureNormal(vec2 textCoord, int textureWidth, int textureHeight,
+	unsigned char* texture, vec3 normal);
+void sampleTexture(Texture* texture, Sampler* sampler, vec2 textCoord,
+	vec2 dTextCoordDx, vec2 dTextCoordDy, float* r, float* g, float* b);
+int getMipWidth(Texture* texture, int level);
+int getMipHeight(Texture* texture, int level);
+
+int preprocessTexture(const char* path, int type);
+Texture* acquireTexture(const char* path, int type);
+int acquireTextures(const char** paths, const int* types, int count, Texture** textures);
+void releaseTexture(Texture* texture);
+void setTextureMemoryBudget(size_t budget);
+size_t getTextureMemoryUsage();
+void destroyTextureRegistry();
@@ -0,0 +1,331 @@
+#include <stdlib.h>
+#include "thread.h"
+
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+struct Thread
+{
+	threadFunction function;
+	void* arg;
+#ifdef _WIN64
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+};
+
+struct Mutex
+{
+#ifdef _WIN64
+	CRITICAL_SECTION handle;
+#else
+	pthread_mutex_t handle;
+#endif
+};
+
+struct Condition
+{
+#ifdef _WIN64
+	CONDITION_VARIABLE handle;
+#else
+	pthread_cond_t handle;
+#endif
+};
+
+int getNumberOfCores()
+{
+#ifdef _WIN64
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+#ifdef _WIN64
+static DWORD WINAPI threadEntry(LPVOID arg)
+{
+	Thread* thread = (Thread*)arg;
+	thread->function(thread->arg);
+	return 0;
+}
+#else
+static void* threadEntry(void* arg)
+{
+	Thread* thread = (Thread*)arg;
+	thread->function(thread->arg);
+	return NULL;
+}
+#endif
+
+Thread* startThread(threadFunction function, void* arg)
+{
+	Thread* thread = malloc(sizeof(Thread));
+	if (!thread)
+		return NULL;
+
+	thread->function = function;
+	thread->arg = arg;
+#ifdef _WIN64
+	thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+	if (!thread->handle)
+#else
+	if (pthread_create(&thread->handle, NULL, threadEntry, thread) != 0)
+#endif
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void joinThread(Thread* thread)
+{
+	if (!thread)
+		return;
+#ifdef _WIN64
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	free(thread);
+}
+
+Mutex* createMutex()
+{
+	Mutex* mutex = malloc(sizeof(Mutex));
+	if (!mutex)
+		return NULL;
+#ifdef _WIN64
+	InitializeCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_init(&mutex->handle, NULL);
+#endif
+	return mutex;
+}
+
+void lockMutex(Mutex* mutex)
+{
+#ifdef _WIN64
+	EnterCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_lock(&mutex->handle);
+#endif
+}
+
+void unlockMutex(Mutex* mutex)
+{
+#ifdef _WIN64
+	LeaveCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_unlock(&mutex->handle);
+#endif
+}
+
+void destroyMutex(Mutex* mutex)
+{
+	if (!mutex)
+		return;
+#ifdef _WIN64
+	DeleteCriticalSection(&mutex->handle);
+#else
+	pthread_mutex_destroy(&mutex->handle);
+#endif
+	free(mutex);
+}
+
+Condition* createCondition()
+{
+	Condition* condition = malloc(sizeof(Condition));
+	if (!condition)
+		return NULL;
+#ifdef _WIN64
+	InitializeConditionVariable(&condition->handle);
+#else
+	pthread_cond_init(&condition->handle, NULL);
+#endif
+	return condition;
+}
+
+void waitCondition(Condition* condition, Mutex* mutex)
+{
+#ifdef _WIN64
+	SleepConditionVariableCS(&condition->handle, &mutex->handle, INFINITE);
+#else
+	pthread_cond_wait(&condition->handle, &mutex->handle);
+#endif
+}
+
+void signalCondition(Condition* condition)
+{
+#ifdef _WIN64
+	WakeConditionVariable(&condition->handle);
+#else
+	pthread_cond_signal(&condition->handle);
+#endif
+}
+
+void broadcastCondition(Condition* condition)
+{
+#ifdef _WIN64
+	WakeAllConditionVariable(&condition->handle);
+#else
+	pthread_cond_broadcast(&condition->handle);
+#endif
+}
+
+void destroyCondition(Condition* condition)
+{
+	if (!condition)
+		return;
+#ifndef _WIN64
+	pthread_cond_destroy(&condition->handle);
+#endif
+	free(condition);
+}
+
+// THREAD POOL
+typedef struct Job
+{
+	threadFunction function;
+	void* arg;
+	struct Job* next;
+}Job;
+
+struct ThreadPool
+{
+	Thread** threads;
+	int numOfThreads;
+	Mutex* mutex;
+	Condition* jobAvailable;
+	Condition* jobsDone;
+	Job* head;
+	Job* tail;
+	int pendingJobs; // queued + running
+	int isStopping;
+};
+
+static void workerLoop(void* arg)
+{
+	ThreadPool* pool = (ThreadPool*)arg;
+
+	lockMutex(pool->mutex);
+	while (1)
+	{
+		while (!pool->head && !pool->isStopping)
+			waitCondition(pool->jobAvailable, pool->mutex);
+		if (!pool->head)
+			break;
+
+		Job* job = pool->head;
+		pool->head = job->next;
+		if (!pool->head)
+			pool->tail = NULL;
+
+		unlockMutex(pool->mutex);
+		job->function(job->arg);
+		free(job);
+		lockMutex(pool->mutex);
+
+		if (--pool->pendingJobs == 0)
+			broadcastCondition(pool->jobsDone);
+	}
+	unlockMutex(pool->mutex);
+}
+
+ThreadPool* createThreadPool(int numOfThreads)
+{
+	if (numOfThreads < 1)
+		numOfThreads = getNumberOfCores();
+
+	ThreadPool* pool = calloc(1, sizeof(ThreadPool));
+	if (!pool)
+		return NULL;
+
+	pool->mutex = createMutex();
+	pool->jobAvailable = createCondition();
+	pool->jobsDone = createCondition();
+	pool->threads = calloc(numOfThreads, sizeof(Thread*));
+	if (!pool->mutex || !pool->jobAvailable || !pool->jobsDone || !pool->threads)
+	{
+		free(pool->threads);
+		destroyCondition(pool->jobsDone);
+		destroyCondition(pool->jobAvailable);
+		destroyMutex(pool->mutex);
+		free(pool);
+		return NULL;
+	}
+	for (int i = 0; i < numOfThreads; i++)
+	{
+		Thread* thread = startThread(workerLoop, pool);
+		if (thread)
+			pool->threads[pool->numOfThreads++] = thread;
+	}
+	return pool;
+}
+
+// runs the job on the calling thread when the pool has no workers
+void submitJob(ThreadPool* pool, threadFunction function, void* arg)
+{
+	Job* job = malloc(sizeof(Job));
+	if (!pool || pool->numOfThreads == 0 || !job)
+	{
+		free(job);
+		function(arg);
+		return;
+	}
+
+	job->function = function;
+	job->arg = arg;
+	job->next = NULL;
+
+	lockMutex(pool->mutex);
+	if (pool->tail)
+		pool->tail->next = job;
+	else
+		pool->head = job;
+	pool->tail = job;
+	pool->pendingJobs++;
+	signalCondition(pool->jobAvailable);
+	unlockMutex(pool->mutex);
+}
+
+void waitThreadPool(ThreadPool* pool)
+{
+	if (!pool)
+		return;
+
+	lockMutex(pool->mutex);
+	while (pool->pendingJobs > 0)
+		waitCondition(pool->jobsDone, pool->mutex);
+	unlockMutex(pool->mutex);
+}
+
+void destroyThreadPool(ThreadPool* pool)
+{
+	if (!pool)
+		return;
+
+	waitThreadPool(pool);
+	lockMutex(pool->mutex);
+	pool->isStopping = 1;
+	broadcastCondition(pool->jobAvailable);
+	unlockMutex(pool->mutex);
+
+	for (int i = 0; i < pool->numOfThreads; i++)
+		joinThread(pool->threads[i]);
+
+	free(pool->threads);
+	destroyCondition(pool->jobsDone);
+	destroyCondition(pool->jobAvailable);
+	destroyMutex(pool->mutex);
+	free(pool);
+}
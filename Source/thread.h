@@ -0,0 +1,31 @@
+#pragma once
+
+// Minimal threading layer over Win32 threads and pthreads.
+typedef void (*threadFunction)(void* arg);
+
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct Condition Condition;
+typedef struct ThreadPool ThreadPool;
+
+int getNumberOfCores();
+
+Thread* startThread(threadFunction function, void* arg);
+void joinThread(Thread* thread);
+
+Mutex* createMutex();
+void lockMutex(Mutex* mutex);
+void unlockMutex(Mutex* mutex);
+void destroyMutex(Mutex* mutex);
+
+Condition* createCondition();
+void waitCondition(Condition* condition, Mutex* mutex);
+void signalCondition(Condition* condition);
+void broadcastCondition(Condition* condition);
+void destroyCondition(Condition* condition);
+
+// fixed size pool of worker threads consuming a FIFO job queue
+ThreadPool* createThreadPool(int numOfThreads);
+void submitJob(ThreadPool* pool, threadFunction function, void* arg);
+void waitThreadPool(ThreadPool* pool);
+void destroyThreadPool(ThreadPool* pool);
@@ -1,2 +1,3 @@
 #define TINYOBJ_LOADER_C_IMPLEMENTATION
+#define TINYOBJ_LOADER_C_USE_THREADS
 #include "tinyobj_loader_c.h"
@@ -86,6 +86,7 @@ typedef struct {
 #define TINYOBJ_ERROR_EMPTY (-1)
 #define TINYOBJ_ERROR_INVALID_PARAMETER (-2)
 #define TINYOBJ_ERROR_FILE_OPERATION (-3)
+#define TINYOBJ_ERROR_MEMORY_ALLOCATION_FAILED (-4)
 
 /* Provide a callback that can read text file without any parsing or modification.
  * The obj and mtl parser is going to read all the necessary data:
@@ -137,6 +138,28 @@ extern int tinyobj_parse_mtl_file(tinyobj_material_t **materials_out,
                                   const char *filename, const char *obj_filename, file_reader_callback file_reader,
 				  void *ctx);
 
+/* Called for every block of a streamed .obj with the attributes and faces of that block only.
+ * Face indices are zero-based over the whole file and may refer to attributes of earlier blocks,
+ * v_offset, vn_offset and vt_offset are the indices of the first attributes of the block.
+ * Returning non zero stops the parsing.
+ */
+typedef int (*tinyobj_block_callback)(void *ctx, const tinyobj_attrib_t *block, size_t v_offset,
+                                      size_t vn_offset, size_t vt_offset);
+
+/* Parse wavefront .obj in blocks of at most block_size bytes, so the file is never held in memory as a whole.
+ * Shapes and materials are not parsed, the material id of every face is -1.
+ * @param[in] file_name File name of .obj
+ * @param[in] flags combination of TINYOBJ_FLAG_***
+ * @param[in] block_size Size of the read buffer, every line has to fit into it.
+ * @param[in] callback Called for every parsed block.
+ * @param[in] ctx Context pointer passed to the callback.
+ *
+ * Returns TINYOBJ_SUCCESS if things goes well.
+ * Returns TINYOBJ_ERROR_FILE_OPERATION when the file can not be read or the callback stopped the parsing.
+ */
+extern int tinyobj_parse_obj_stream(const char *file_name, unsigned int flags, size_t block_size,
+                                    tinyobj_block_callback callback, void *ctx);
+
 extern void tinyobj_attrib_init(tinyobj_attrib_t *attrib);
 extern void tinyobj_attrib_free(tinyobj_attrib_t *attrib);
 extern void tinyobj_shapes_free(tinyobj_shape_t *shapes, size_t num_shapes);
@@ -149,6 +172,22 @@ extern void tinyobj_materials_free(tinyobj_material_t *materials,
 #include <string.h>
 #include <errno.h>
 
+/* With TINYOBJ_LOADER_C_USE_THREADS the lines are parsed in chunks on a thread pool of thread.h. */
+#ifdef TINYOBJ_LOADER_C_USE_THREADS
+#include "thread.h"
+typedef ThreadPool tinyobj_thread_pool_t;
+#else
+typedef void tinyobj_thread_pool_t;
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TINYOBJ_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 #if defined(TINYOBJ_MALLOC) && defined(TINYOBJ_REALLOC) && defined(TINYOBJ_CALLOC) && defined(TINYOBJ_FREE)
 /* ok */
 #elif !defined(TINYOBJ_MALLOC) && !defined(TINYOBJ_REALLOC) && !defined(TINYOBJ_CALLOC) && !defined(TINYOBJ_FREE)
@@ -166,6 +205,9 @@ extern void tinyobj_materials_free(tinyobj_material_t *materials,
 #endif
 
 #define TINYOBJ_MAX_FACES_PER_F_LINE (16)
+#ifndef TINYOBJ_LINES_PER_CHUNK
+#define TINYOBJ_LINES_PER_CHUNK (64 * 1024)
+#endif
 #define TINYOBJ_MAX_FILEPATH (8192)
 
 #define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
@@ -331,6 +373,16 @@ static int parseInt(const char **token) {
  *  - s >= s_end.
  *  - parse failure.
  */
+/* Powers of five which are exact in a double, the same values the repeated
+ * multiplication gives. */
+static const double pow5_table[23] = {
+  1.0, 5.0, 25.0, 125.0, 625.0, 3125.0, 15625.0, 78125.0, 390625.0,
+  1953125.0, 9765625.0, 48828125.0, 244140625.0, 1220703125.0,
+  6103515625.0, 30517578125.0, 152587890625.0, 762939453125.0,
+  3814697265625.0, 19073486328125.0, 95367431640625.0,
+  476837158203125.0, 2384185791015625.0
+};
+
 static int tryParseDouble(const char *s, const char *s_end, double *result) {
   double mantissa = 0.0;
   /* This exponent is base 2 rather than 10.
@@ -342,6 +394,7 @@ static int tryParseDouble(const char *s, const char *s_end, double *result) {
    * exponent to be in base 2.
    */
   int exponent = 0;
+  double frac_value = 1.0;
 
   /* NOTE: THESE MUST BE DECLARED HERE SINCE WE ARE NOT ALLOWED
    * TO JUMP OVER DEFINITIONS.
@@ -393,12 +446,8 @@ static int tryParseDouble(const char *s, const char *s_end, double *result) {
     read = 1;
     end_not_reached = (curr != s_end);
     while (end_not_reached && IS_DIGIT(*curr)) {
-      /* pow(10.0, -read) */
-      double frac_value = 1.0;
-      int f;
-      for (f = 0; f < read; f++) {
-        frac_value *= 0.1;
-      }
+      /* pow(10.0, -read), one more factor of 0.1 per digit */
+      frac_value *= 0.1;
       mantissa += (int)(*curr - 0x30) * frac_value;
       read++;
       curr++;
@@ -428,8 +477,11 @@ static int tryParseDouble(const char *s, const char *s_end, double *result) {
     read = 0;
     end_not_reached = (curr != s_end);
     while (end_not_reached && IS_DIGIT(*curr)) {
-      exponent *= 10;
-      exponent += (int)(*curr - 0x30);
+      /* any exponent past the double range gives the same result, stop before it overflows */
+      if (exponent < 100000) {
+        exponent *= 10;
+        exponent += (int)(*curr - 0x30);
+      }
       curr++;
       read++;
       end_not_reached = (curr != s_end);
@@ -443,8 +495,12 @@ assemble :
     double a = 1.0; /* = pow(5.0, exponent); */
     double b  = 1.0; /* = 2.0^exponent */
     int i;
-    for (i = 0; i < exponent; i++) {
-      a = a * 5.0;
+    if (exponent < (int)(sizeof(pow5_table) / sizeof(pow5_table[0]))) {
+      a = pow5_table[exponent];
+    } else {
+      for (i = 0; i < exponent; i++) {
+        a = a * 5.0;
+      }
     }
 
     for (i = 0; i < exponent; i++) {
@@ -467,11 +523,50 @@ fail:
   return 0;
 }
 
+/* Fast path for the plain decimals of vertex data, [+-]digits[.digits] ending
+ * where until_space would end the token. The digits are accumulated in the
+ * same order and precision as tryParseDouble, so the value is bit-exact, but
+ * the token is scanned only once. Anything else is left to tryParseDouble. */
+static int tryParseDecimal(const char **token, double *result) {
+  const char *curr = *token;
+  double mantissa = 0.0;
+  double frac_value = 1.0;
+  char sign = '+';
+
+  if (*curr == '+' || *curr == '-') {
+    sign = *curr;
+    curr++;
+  }
+  if (!IS_DIGIT(*curr)) return 0;
+
+  while (IS_DIGIT(*curr)) {
+    mantissa *= 10;
+    mantissa += (int)(*curr - 0x30);
+    curr++;
+  }
+  if (*curr == '.') {
+    curr++;
+    while (IS_DIGIT(*curr)) {
+      frac_value *= 0.1;
+      mantissa += (int)(*curr - 0x30) * frac_value;
+      curr++;
+    }
+  }
+  if (*curr != '\0' && *curr != ' ' && *curr != '\t' && *curr != '\r') return 0;
+
+  *result = (sign == '+' ? 1 : -1) * mantissa;
+  *token = curr;
+  return 1;
+}
+
 static float parseFloat(const char **token) {
   const char *end;
   double val = 0.0;
   float f = 0.0f;
   skip_space(token);
+  if (tryParseDecimal(token, &val)) {
+    return (float)val;
+  }
   end = (*token) + until_space((*token));
   val = 0.0;
   tryParseDouble((*token), end, &val);
@@ -776,48 +871,98 @@ typedef struct {
   size_t len;
 } LineInfo;
 
-/* Find '\n' and create line data. */
+#ifdef TINYOBJ_SSE2
+static int find_first_bit(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int)index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/* Find line endings and create line data in a single pass. With SSE2 the
+ * buffer is skipped 16 bytes at a time up to the next '\n', '\r' or '\0',
+ * only those are checked with is_line_ending. */
 static int get_line_infos(const char *buf, size_t buf_len, LineInfo **line_infos, size_t *num_lines)
 {
   size_t i = 0;
   size_t end_idx = buf_len;
   size_t prev_pos = 0;
-  size_t line_no = 0;
   size_t last_line_ending = 0;
+  /* guessed from short vertex lines, grown when the lines are shorter */
+  size_t capacity = buf_len / 32 + 16;
+  LineInfo *infos = (LineInfo *)TINYOBJ_MALLOC(sizeof(LineInfo) * capacity);
+#ifdef TINYOBJ_SSE2
+  const __m128i line_feeds = _mm_set1_epi8('\n');
+  const __m128i carriage_returns = _mm_set1_epi8('\r');
+  const __m128i zeros = _mm_setzero_si128();
+#endif
 
-  /* Count # of lines. */
-  for (i = 0; i < end_idx; i++) {
+  *num_lines = 0;
+  if (infos == NULL) return TINYOBJ_ERROR_EMPTY;
+
+  while (i < end_idx) {
+#ifdef TINYOBJ_SSE2
+    for (; i + 16 <= end_idx; i += 16) {
+      __m128i chars = _mm_loadu_si128((const __m128i *)(buf + i));
+      __m128i endings = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, line_feeds),
+                                                  _mm_cmpeq_epi8(chars, carriage_returns)),
+                                     _mm_cmpeq_epi8(chars, zeros));
+      unsigned int mask = (unsigned int)_mm_movemask_epi8(endings);
+      if (mask) {
+        i += (size_t)find_first_bit(mask);
+        break;
+      }
+    }
+    if (i >= end_idx) break;
+#endif
     if (is_line_ending(buf, i, end_idx)) {
+      if (*num_lines == capacity) {
+        LineInfo *grown;
+        capacity *= 2;
+        grown = (LineInfo *)TINYOBJ_REALLOC(infos, sizeof(LineInfo) * capacity);
+        if (grown == NULL) {
+          TINYOBJ_FREE(infos);
+          return TINYOBJ_ERROR_EMPTY;
+        }
+        infos = grown;
+      }
+      infos[*num_lines].pos = prev_pos;
+      infos[*num_lines].len = i - prev_pos;
       (*num_lines)++;
+      prev_pos = i + 1;
       last_line_ending = i;
     }
+    i++;
   }
+
   /* The last char from the input may not be a line
     * ending character so add an extra line if there
     * are more characters after the last line ending
     * that was found. */
   if (end_idx - last_line_ending > 0) {
-      (*num_lines)++;
-  }
-
-  if (*num_lines == 0) return TINYOBJ_ERROR_EMPTY;
-
-  *line_infos = (LineInfo *)TINYOBJ_MALLOC(sizeof(LineInfo) * (*num_lines));
-
-  /* Fill line infos. */
-  for (i = 0; i < end_idx; i++) {
-    if (is_line_ending(buf, i, end_idx)) {
-      (*line_infos)[line_no].pos = prev_pos;
-      (*line_infos)[line_no].len = i - prev_pos;
-      prev_pos = i + 1;
-      line_no++;
+    if (*num_lines == capacity) {
+      LineInfo *grown = (LineInfo *)TINYOBJ_REALLOC(infos, sizeof(LineInfo) * (capacity + 1));
+      if (grown == NULL) {
+        TINYOBJ_FREE(infos);
+        return TINYOBJ_ERROR_EMPTY;
+      }
+      infos = grown;
     }
+    infos[*num_lines].pos = prev_pos;
+    infos[*num_lines].len = end_idx - 1 - last_line_ending;
+    (*num_lines)++;
   }
-  if (end_idx - last_line_ending > 0) {
-    (*line_infos)[line_no].pos = prev_pos;
-    (*line_infos)[line_no].len = end_idx - 1 - last_line_ending;
+
+  if (*num_lines == 0) {
+    TINYOBJ_FREE(infos);
+    return TINYOBJ_ERROR_EMPTY;
   }
 
+  *line_infos = infos;
   return 0;
 }
 
@@ -1297,6 +1442,183 @@ static int parseLine(Command *command, const char *p, size_t p_len,
   return 0;
 }
 
+/* A range of lines, parsed and then stored into the attributes independently of the
+ * other chunks. The offsets of a chunk are the counts of all chunks before it. */
+typedef struct {
+  const char *buf;
+  const LineInfo *line_infos;
+  Command *commands;
+  size_t line_begin;
+  size_t line_end;
+  int triangulate;
+
+  /* counted while parsing */
+  size_t num_v;
+  size_t num_vn;
+  size_t num_vt;
+  size_t num_f;
+  size_t num_faces;
+  int mtllib_line_index;
+  int usemtl_line_index;
+
+  /* global counts before the block of the chunk, non zero only when streaming */
+  size_t v_base;
+  size_t vn_base;
+  size_t vt_base;
+
+  /* assigned by the reduction */
+  size_t v_offset;
+  size_t vn_offset;
+  size_t vt_offset;
+  size_t f_offset;
+  size_t face_offset;
+  int material_id; /* material of the faces before the first usemtl of the chunk */
+  tinyobj_attrib_t *attrib;
+  hash_table_t *material_table;
+} ParseChunk;
+
+static void parse_chunk(void *arg) {
+  ParseChunk *chunk = (ParseChunk *)arg;
+  size_t i = 0;
+
+  chunk->mtllib_line_index = -1;
+  chunk->usemtl_line_index = -1;
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    Command *command = &chunk->commands[i];
+    int ret = parseLine(command, &chunk->buf[chunk->line_infos[i].pos],
+                        chunk->line_infos[i].len, chunk->triangulate);
+    if (ret) {
+      if (command->type == COMMAND_V) {
+        chunk->num_v++;
+      } else if (command->type == COMMAND_VN) {
+        chunk->num_vn++;
+      } else if (command->type == COMMAND_VT) {
+        chunk->num_vt++;
+      } else if (command->type == COMMAND_F) {
+        chunk->num_f += command->num_f;
+        chunk->num_faces += command->num_f_num_verts;
+      } else if (command->type == COMMAND_USEMTL) {
+        chunk->usemtl_line_index = (int)i;
+      }
+
+      if (command->type == COMMAND_MTLLIB) {
+        chunk->mtllib_line_index = (int)i;
+      }
+    }
+  }
+}
+
+/* id of the material named by a usemtl command, -1 when it is unknown */
+static int find_material_id(const Command *command, int material_id, hash_table_t *material_table) {
+  if (command->material_name &&
+     command->material_name_len >0)
+  {
+    /* Create a null terminated string */
+    char* material_name_null_term = (char*) TINYOBJ_MALLOC(command->material_name_len + 1);
+    memcpy((void*) material_name_null_term, (const void*) command->material_name, command->material_name_len);
+    material_name_null_term[command->material_name_len] = 0;
+
+    if (hash_table_exists(material_name_null_term, material_table))
+      material_id = (int)hash_table_get(material_name_null_term, material_table);
+    else
+      material_id = -1;
+
+    TINYOBJ_FREE(material_name_null_term);
+  }
+  return material_id;
+}
+
+static void construct_chunk(void *arg) {
+  ParseChunk *chunk = (ParseChunk *)arg;
+  tinyobj_attrib_t *attrib = chunk->attrib;
+  size_t v_count = chunk->v_offset;
+  size_t n_count = chunk->vn_offset;
+  size_t t_count = chunk->vt_offset;
+  size_t f_count = chunk->f_offset;
+  size_t face_count = chunk->face_offset;
+  int material_id = chunk->material_id;
+  size_t i = 0;
+
+  for (i = chunk->line_begin; i < chunk->line_end; i++) {
+    const Command *command = &chunk->commands[i];
+    if (command->type == COMMAND_EMPTY) {
+      continue;
+    } else if (command->type == COMMAND_USEMTL) {
+      material_id = find_material_id(command, material_id, chunk->material_table);
+    } else if (command->type == COMMAND_V) {
+      attrib->vertices[3 * v_count + 0] = command->vx;
+      attrib->vertices[3 * v_count + 1] = command->vy;
+      attrib->vertices[3 * v_count + 2] = command->vz;
+      v_count++;
+    } else if (command->type == COMMAND_VN) {
+      attrib->normals[3 * n_count + 0] = command->nx;
+      attrib->normals[3 * n_count + 1] = command->ny;
+      attrib->normals[3 * n_count + 2] = command->nz;
+      n_count++;
+    } else if (command->type == COMMAND_VT) {
+      attrib->texcoords[2 * t_count + 0] = command->tx;
+      attrib->texcoords[2 * t_count + 1] = command->ty;
+      t_count++;
+    } else if (command->type == COMMAND_F) {
+      size_t k = 0;
+      for (k = 0; k < command->num_f; k++) {
+        tinyobj_vertex_index_t vi = command->f[k];
+        int v_idx = fixIndex(vi.v_idx, chunk->v_base + v_count);
+        int vn_idx = fixIndex(vi.vn_idx, chunk->vn_base + n_count);
+        int vt_idx = fixIndex(vi.vt_idx, chunk->vt_base + t_count);
+        attrib->faces[f_count + k].v_idx = v_idx;
+        attrib->faces[f_count + k].vn_idx = vn_idx;
+        attrib->faces[f_count + k].vt_idx = vt_idx;
+      }
+
+      for (k = 0; k < command->num_f_num_verts; k++) {
+        attrib->material_ids[face_count + k] = material_id;
+        attrib->face_num_verts[face_count + k] = command->f_num_verts[k];
+      }
+
+      f_count += command->num_f;
+      face_count += command->num_f_num_verts;
+    }
+  }
+}
+
+/* The pool is created once per parse and shared by all of its run_chunks calls, NULL without threads. */
+static tinyobj_thread_pool_t *create_chunk_pool(void) {
+#ifdef TINYOBJ_LOADER_C_USE_THREADS
+  return createThreadPool(0);
+#else
+  return NULL;
+#endif
+}
+
+static void destroy_chunk_pool(tinyobj_thread_pool_t *pool) {
+#ifdef TINYOBJ_LOADER_C_USE_THREADS
+  destroyThreadPool(pool);
+#else
+  (void)pool;
+#endif
+}
+
+/* Runs the job for every chunk, on the thread pool when there is one and more than one chunk. */
+static void run_chunks(tinyobj_thread_pool_t *pool, ParseChunk *chunks, size_t num_chunks,
+                       void (*job)(void *)) {
+  size_t i = 0;
+#ifdef TINYOBJ_LOADER_C_USE_THREADS
+  if (pool && num_chunks > 1) {
+    for (i = 0; i < num_chunks; i++) {
+      submitJob(pool, job, &chunks[i]);
+    }
+    waitThreadPool(pool);
+    return;
+  }
+#else
+  (void)pool;
+#endif
+  for (i = 0; i < num_chunks; i++) {
+    job(&chunks[i]);
+  }
+}
+
 static size_t basename_len(const char *filename, size_t filename_length) {
   /* Count includes NUL terminator. */
   const char *p = &filename[filename_length - 1];
@@ -1363,6 +1685,9 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   LineInfo *line_infos = NULL;
   Command *commands = NULL;
   size_t num_lines = 0;
+  ParseChunk *chunks = NULL;
+  size_t num_chunks = 0;
+  tinyobj_thread_pool_t *pool = NULL;
 
   size_t num_v = 0;
   size_t num_vn = 0;
@@ -1400,27 +1725,35 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
 
   create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
 
-  /* 2. parse each line */
+  /* 2. parse each chunk of lines, then sum the counts of the chunks */
+  num_chunks = (num_lines + TINYOBJ_LINES_PER_CHUNK - 1) / TINYOBJ_LINES_PER_CHUNK;
+  chunks = (ParseChunk *)TINYOBJ_CALLOC(num_chunks, sizeof(ParseChunk));
+  pool = create_chunk_pool();
   {
     size_t i = 0;
-    for (i = 0; i < num_lines; i++) {
-      int ret = parseLine(&commands[i], &buf[line_infos[i].pos],
-                          line_infos[i].len, flags & TINYOBJ_FLAG_TRIANGULATE);
-      if (ret) {
-        if (commands[i].type == COMMAND_V) {
-          num_v++;
-        } else if (commands[i].type == COMMAND_VN) {
-          num_vn++;
-        } else if (commands[i].type == COMMAND_VT) {
-          num_vt++;
-        } else if (commands[i].type == COMMAND_F) {
-          num_f += commands[i].num_f;
-          num_faces += commands[i].num_f_num_verts;
-        }
-
-        if (commands[i].type == COMMAND_MTLLIB) {
-          mtllib_line_index = (int)i;
-        }
+    for (i = 0; i < num_chunks; i++) {
+      chunks[i].buf = buf;
+      chunks[i].line_infos = line_infos;
+      chunks[i].commands = commands;
+      chunks[i].line_begin = i * TINYOBJ_LINES_PER_CHUNK;
+      chunks[i].line_end = (i + 1 == num_chunks) ? num_lines : (i + 1) * TINYOBJ_LINES_PER_CHUNK;
+      chunks[i].triangulate = flags & TINYOBJ_FLAG_TRIANGULATE;
+    }
+    run_chunks(pool, chunks, num_chunks, parse_chunk);
+
+    for (i = 0; i < num_chunks; i++) {
+      chunks[i].v_offset = num_v;
+      chunks[i].vn_offset = num_vn;
+      chunks[i].vt_offset = num_vt;
+      chunks[i].f_offset = num_f;
+      chunks[i].face_offset = num_faces;
+      num_v += chunks[i].num_v;
+      num_vn += chunks[i].num_vn;
+      num_vt += chunks[i].num_vt;
+      num_f += chunks[i].num_f;
+      num_faces += chunks[i].num_faces;
+      if (chunks[i].mtllib_line_index >= 0) {
+        mtllib_line_index = chunks[i].mtllib_line_index;
       }
     }
   }
@@ -1467,11 +1800,6 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   /* Construct attributes */
 
   {
-    size_t v_count = 0;
-    size_t n_count = 0;
-    size_t t_count = 0;
-    size_t f_count = 0;
-    size_t face_count = 0;
     int material_id = -1; /* -1 = default unknown material. */
     size_t i = 0;
 
@@ -1488,75 +1816,18 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
     attrib->material_ids = (int *)TINYOBJ_MALLOC(sizeof(int) * num_faces);
     attrib->num_face_num_verts = (unsigned int)num_faces;
 
-    for (i = 0; i < num_lines; i++) {
-      if (commands[i].type == COMMAND_EMPTY) {
-        continue;
-      } else if (commands[i].type == COMMAND_USEMTL) {
-        /* @todo
-           if (commands[t][i].material_name &&
-           commands[t][i].material_name_len > 0) {
-           std::string material_name(commands[t][i].material_name,
-           commands[t][i].material_name_len);
-
-           if (material_map.find(material_name) != material_map.end()) {
-           material_id = material_map[material_name];
-           } else {
-        // Assign invalid material ID
-        material_id = -1;
-        }
-        }
-        */
-        if (commands[i].material_name &&
-           commands[i].material_name_len >0)
-        {
-          /* Create a null terminated string */
-          char* material_name_null_term = (char*) TINYOBJ_MALLOC(commands[i].material_name_len + 1);
-          memcpy((void*) material_name_null_term, (const void*) commands[i].material_name, commands[i].material_name_len);
-          material_name_null_term[commands[i].material_name_len] = 0;
-
-          if (hash_table_exists(material_name_null_term, &material_table))
-            material_id = (int)hash_table_get(material_name_null_term, &material_table);
-          else
-            material_id = -1;
-
-          TINYOBJ_FREE(material_name_null_term);
-        }
-      } else if (commands[i].type == COMMAND_V) {
-        attrib->vertices[3 * v_count + 0] = commands[i].vx;
-        attrib->vertices[3 * v_count + 1] = commands[i].vy;
-        attrib->vertices[3 * v_count + 2] = commands[i].vz;
-        v_count++;
-      } else if (commands[i].type == COMMAND_VN) {
-        attrib->normals[3 * n_count + 0] = commands[i].nx;
-        attrib->normals[3 * n_count + 1] = commands[i].ny;
-        attrib->normals[3 * n_count + 2] = commands[i].nz;
-        n_count++;
-      } else if (commands[i].type == COMMAND_VT) {
-        attrib->texcoords[2 * t_count + 0] = commands[i].tx;
-        attrib->texcoords[2 * t_count + 1] = commands[i].ty;
-        t_count++;
-      } else if (commands[i].type == COMMAND_F) {
-        size_t k = 0;
-        for (k = 0; k < commands[i].num_f; k++) {
-          tinyobj_vertex_index_t vi = commands[i].f[k];
-          int v_idx = fixIndex(vi.v_idx, v_count);
-          int vn_idx = fixIndex(vi.vn_idx, n_count);
-          int vt_idx = fixIndex(vi.vt_idx, t_count);
-          attrib->faces[f_count + k].v_idx = v_idx;
-          attrib->faces[f_count + k].vn_idx = vn_idx;
-          attrib->faces[f_count + k].vt_idx = vt_idx;
-        }
-
-        for (k = 0; k < commands[i].num_f_num_verts; k++) {
-          attrib->material_ids[face_count + k] = material_id;
-          attrib->face_num_verts[face_count + k] = commands[i].f_num_verts[k];
-        }
-
-        f_count += commands[i].num_f;
-        face_count += commands[i].num_f_num_verts;
+    /* the material of a chunk starts as the last one selected in the chunks before it */
+    for (i = 0; i < num_chunks; i++) {
+      chunks[i].material_id = material_id;
+      chunks[i].attrib = attrib;
+      chunks[i].material_table = &material_table;
+      if (chunks[i].usemtl_line_index >= 0) {
+        material_id = find_material_id(&commands[chunks[i].usemtl_line_index], material_id, &material_table);
       }
     }
+    run_chunks(pool, chunks, num_chunks, construct_chunk);
   }
+  destroy_chunk_pool(pool);
 
   /* 5. Construct shape information. */
   {
@@ -1654,6 +1925,7 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   if (commands) {
     TINYOBJ_FREE(commands);
   }
+  TINYOBJ_FREE(chunks);
 
   destroy_hash_table(&material_table);
 
@@ -1663,6 +1935,144 @@ int tinyobj_parse_obj(tinyobj_attrib_t *attrib, tinyobj_shape_t **shapes,
   return TINYOBJ_SUCCESS;
 }
 
+/* Parses one block of whole lines into its own attributes and hands them to the callback. */
+static int parse_obj_block(const char *buf, size_t len, unsigned int flags, size_t *num_v,
+                           size_t *num_vn, size_t *num_vt, hash_table_t *material_table,
+                           tinyobj_thread_pool_t *pool, tinyobj_block_callback callback, void *ctx) {
+  LineInfo *line_infos = NULL;
+  Command *commands = NULL;
+  ParseChunk *chunks = NULL;
+  size_t num_lines = 0;
+  size_t num_chunks = 0;
+  size_t block_v = 0, block_vn = 0, block_vt = 0, block_f = 0, block_faces = 0;
+  size_t i = 0;
+  tinyobj_attrib_t attrib;
+  int ret = TINYOBJ_SUCCESS;
+
+  if (get_line_infos(buf, len, &line_infos, &num_lines) != 0) {
+    return TINYOBJ_ERROR_EMPTY;
+  }
+
+  commands = (Command *)TINYOBJ_MALLOC(sizeof(Command) * num_lines);
+
+  num_chunks = (num_lines + TINYOBJ_LINES_PER_CHUNK - 1) / TINYOBJ_LINES_PER_CHUNK;
+  chunks = (ParseChunk *)TINYOBJ_CALLOC(num_chunks, sizeof(ParseChunk));
+  for (i = 0; i < num_chunks; i++) {
+    chunks[i].buf = buf;
+    chunks[i].line_infos = line_infos;
+    chunks[i].commands = commands;
+    chunks[i].line_begin = i * TINYOBJ_LINES_PER_CHUNK;
+    chunks[i].line_end = (i + 1 == num_chunks) ? num_lines : (i + 1) * TINYOBJ_LINES_PER_CHUNK;
+    chunks[i].triangulate = flags & TINYOBJ_FLAG_TRIANGULATE;
+  }
+  run_chunks(pool, chunks, num_chunks, parse_chunk);
+
+  for (i = 0; i < num_chunks; i++) {
+    chunks[i].v_base = *num_v;
+    chunks[i].vn_base = *num_vn;
+    chunks[i].vt_base = *num_vt;
+    chunks[i].v_offset = block_v;
+    chunks[i].vn_offset = block_vn;
+    chunks[i].vt_offset = block_vt;
+    chunks[i].f_offset = block_f;
+    chunks[i].face_offset = block_faces;
+    chunks[i].material_id = -1;
+    chunks[i].attrib = &attrib;
+    chunks[i].material_table = material_table;
+    block_v += chunks[i].num_v;
+    block_vn += chunks[i].num_vn;
+    block_vt += chunks[i].num_vt;
+    block_f += chunks[i].num_f;
+    block_faces += chunks[i].num_faces;
+  }
+
+  tinyobj_attrib_init(&attrib);
+  attrib.vertices = (float *)TINYOBJ_MALLOC(sizeof(float) * block_v * 3);
+  attrib.num_vertices = (unsigned int)block_v;
+  attrib.normals = (float *)TINYOBJ_MALLOC(sizeof(float) * block_vn * 3);
+  attrib.num_normals = (unsigned int)block_vn;
+  attrib.texcoords = (float *)TINYOBJ_MALLOC(sizeof(float) * block_vt * 2);
+  attrib.num_texcoords = (unsigned int)block_vt;
+  attrib.faces = (tinyobj_vertex_index_t *)TINYOBJ_MALLOC(sizeof(tinyobj_vertex_index_t) * block_f);
+  attrib.num_faces = (unsigned int)block_f;
+  attrib.face_num_verts = (int *)TINYOBJ_MALLOC(sizeof(int) * block_faces);
+  attrib.material_ids = (int *)TINYOBJ_MALLOC(sizeof(int) * block_faces);
+  attrib.num_face_num_verts = (unsigned int)block_faces;
+  run_chunks(pool, chunks, num_chunks, construct_chunk);
+
+  if (callback(ctx, &attrib, *num_v, *num_vn, *num_vt) != 0) {
+    ret = TINYOBJ_ERROR_FILE_OPERATION;
+  }
+  *num_v += block_v;
+  *num_vn += block_vn;
+  *num_vt += block_vt;
+
+  tinyobj_attrib_free(&attrib);
+  TINYOBJ_FREE(chunks);
+  TINYOBJ_FREE(commands);
+  TINYOBJ_FREE(line_infos);
+  return ret;
+}
+
+int tinyobj_parse_obj_stream(const char *file_name, unsigned int flags, size_t block_size,
+                             tinyobj_block_callback callback, void *ctx) {
+  FILE *fp;
+  char *buf;
+  size_t carry = 0;
+  size_t num_v = 0, num_vn = 0, num_vt = 0;
+  int eof = 0;
+  int ret = TINYOBJ_SUCCESS;
+  hash_table_t material_table;
+  tinyobj_thread_pool_t *pool;
+
+  if (file_name == NULL || callback == NULL) return TINYOBJ_ERROR_INVALID_PARAMETER;
+  if (block_size < 4096) return TINYOBJ_ERROR_INVALID_PARAMETER; /* the longest line parseLine takes */
+
+  fp = fopen(file_name, "rb");
+  if (fp == NULL) return TINYOBJ_ERROR_FILE_OPERATION;
+  buf = (char *)TINYOBJ_MALLOC(block_size);
+  if (buf == NULL) {
+    fclose(fp);
+    return TINYOBJ_ERROR_MEMORY_ALLOCATION_FAILED;
+  }
+
+  /* no material is loaded, the table stays empty */
+  create_hash_table(HASH_TABLE_DEFAULT_SIZE, &material_table);
+  /* one pool for all blocks, every block runs two passes over its chunks */
+  pool = create_chunk_pool();
+
+  while (ret == TINYOBJ_SUCCESS && !eof) {
+    size_t len = carry + fread(buf + carry, 1, block_size - carry, fp);
+    size_t end = len;
+    eof = len < block_size;
+    if (ferror(fp)) {
+      ret = TINYOBJ_ERROR_FILE_OPERATION;
+      break;
+    }
+
+    /* the block ends after its last line ending, the partial line after it is carried over to the next block */
+    if (!eof) {
+      while (end > 0 && buf[end - 1] != '\n' && buf[end - 1] != '\r') end--;
+      if (end == 0) {
+        ret = TINYOBJ_ERROR_INVALID_PARAMETER; /* a line longer than the block */
+        break;
+      }
+    }
+
+    if (end > 0) {
+      ret = parse_obj_block(buf, end, flags, &num_v, &num_vn, &num_vt, &material_table, pool, callback, ctx);
+    }
+    carry = len - end;
+    memmove(buf, buf + end, carry);
+  }
+
+  destroy_chunk_pool(pool);
+  destroy_hash_table(&material_table);
+  TINYOBJ_FREE(buf);
+  fclose(fp);
+  return ret;
+}
+
 void tinyobj_attrib_init(tinyobj_attrib_t *attrib) {
   attrib->vertices = NULL;
   attrib->num_vertices = 0;
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include "tripleBuffer.h"
+#include "thread.h"
+
+struct TripleBuffer
+{
+	char* buffers[3];
+	int back; // written by the renderer
+	int ready; // newest published frame
+	int front; // shown by the display
+	int isReadyNew;
+	pixelRect readyRect; // changed since the front buffer
+	int numOfPublishedFrames;
+	int isClosed;
+	Mutex* mutex;
+};
+
+TripleBuffer* createTripleBuffer(size_t size)
+{
+	TripleBuffer* buffer = calloc(1, sizeof(TripleBuffer));
+	if (!buffer)
+		return NULL;
+	buffer->mutex = createMutex();
+	for (int i = 0; i < 3; i++)
+		buffer->buffers[i] = calloc(1, size);
+	if (!buffer->mutex || !buffer->buffers[0] || !buffer->buffers[1] || !buffer->buffers[2])
+	{
+		destroyTripleBuffer(buffer);
+		return NULL;
+	}
+	buffer->back = 0;
+	buffer->ready = 1;
+	buffer->front = 2;
+	return buffer;
+}
+
+char* getTripleBufferBack(TripleBuffer* buffer)
+{
+	// only the renderer swaps the back buffer, no lock is needed to read it
+	return buffer->buffers[buffer->back];
+}
+
+void publishTripleBuffer(TripleBuffer* buffer, const pixelRect* dirtyRect)
+{
+	lockMutex(buffer->mutex);
+	unionRect(&buffer->readyRect, dirtyRect);
+	int ready = buffer->ready;
+	buffer->ready = buffer->back;
+	buffer->back = ready;
+	buffer->isReadyNew = 1;
+	buffer->numOfPublishedFrames++;
+	unlockMutex(buffer->mutex);
+}
+
+char* acquireTripleBufferFront(TripleBuffer* buffer, pixelRect* dirtyRect)
+{
+	lockMutex(buffer->mutex);
+	*dirtyRect = (pixelRect){ 0, 0, 0, 0 };
+	if (buffer->isReadyNew)
+	{
+		*dirtyRect = buffer->readyRect;
+		buffer->readyRect = (pixelRect){ 0, 0, 0, 0 };
+		int front = buffer->front;
+		buffer->front = buffer->ready;
+		buffer->ready = front;
+		buffer->isReadyNew = 0;
+	}
+	char* front = buffer->buffers[buffer->front];
+	unlockMutex(buffer->mutex);
+	return front;
+}
+
+int getNumberOfPublishedFrames(TripleBuffer* buffer)
+{
+	lockMutex(buffer->mutex);
+	int numOfPublishedFrames = buffer->numOfPublishedFrames;
+	unlockMutex(buffer->mutex);
+	return numOfPublishedFrames;
+}
+
+void closeTripleBuffer(TripleBuffer* buffer)
+{
+	lockMutex(buffer->mutex);
+	buffer->isClosed = 1;
+	unlockMutex(buffer->mutex);
+}
+
+int isTripleBufferClosed(TripleBuffer* buffer)
+{
+	lockMutex(buffer->mutex);
+	int isClosed = buffer->isClosed;
+	unlockMutex(buffer->mutex);
+	return isClosed;
+}
+
+void destroyTripleBuffer(TripleBuffer* buffer)
+{
+	if (!buffer)
+		return;
+	for (int i = 0; i < 3; i++)
+		free(buffer->buffers[i]);
+	destroyMutex(buffer->mutex);
+	free(buffer);
+}
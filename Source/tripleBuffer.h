@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include "framebuffer.h"
+
+// Latest-frame exchange between the render thread and the display. The renderer fills the
+// back buffer and publishes it, the display takes the newest published frame at vsync.
+// Neither side waits for the other, frames the display did not pick up are dropped.
+typedef struct TripleBuffer TripleBuffer;
+
+TripleBuffer* createTripleBuffer(size_t size);
+char* getTripleBufferBack(TripleBuffer* buffer);
+// dirtyRect is the region changed since the previously published frame
+void publishTripleBuffer(TripleBuffer* buffer, const pixelRect* dirtyRect);
+// The front buffer stays valid until the next call. dirtyRect is the region changed
+// since the last call, the union over the dropped frames, and empty without a new frame.
+char* acquireTripleBufferFront(TripleBuffer* buffer, pixelRect* dirtyRect);
+int getNumberOfPublishedFrames(TripleBuffer* buffer);
+// closing tells the renderer to stop
+void closeTripleBuffer(TripleBuffer* buffer);
+int isTripleBufferClosed(TripleBuffer* buffer);
+void destroyTripleBuffer(TripleBuffer* buffer);
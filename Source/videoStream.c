@@ -0,0 +1,208 @@
+#ifndef _WIN64
+#define _GNU_SOURCE // posix_fallocate
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "videoStream.h"
+#include "imageWriter.h"
+
+#ifdef _WIN64
+#include <io.h>
+#include <fcntl.h>
+#define popen _popen
+#define pclose _pclose
+#define PIPE_WRITE_MODE "wb"
+#else
+#define PIPE_WRITE_MODE "w"
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define Y4M_FRAME_HEADER "FRAME\n"
+
+struct VideoStream
+{
+	FILE* file;
+	int isPipe;
+	int isStdout;
+	int format;
+	int width;
+	int height;
+	size_t frameSize; // with the frame header of y4m
+	size_t numOfFrames;
+	size_t numOfPreallocatedFrames;
+};
+
+int getVideoFormat(const char* target)
+{
+	const char* extension = strrchr(target, '.');
+	return extension && strcmp(extension, ".rgb") == 0 ? VIDEO_RAW_RGB : VIDEO_Y4M;
+}
+
+// sets the file size up front so the file system does not grow it frame by frame
+static void preallocateFile(FILE* file, size_t size)
+{
+#ifdef _WIN64
+	_chsize_s(_fileno(file), (__int64)size);
+#else
+	posix_fallocate(fileno(file), 0, (off_t)size);
+#endif
+}
+
+static void truncateFile(FILE* file, size_t size)
+{
+	fflush(file);
+#ifdef _WIN64
+	_chsize_s(_fileno(file), (__int64)size);
+#else
+	if (ftruncate(fileno(file), (off_t)size) != 0)
+		fprintf(stderr, "failed to truncate the video file\n");
+#endif
+}
+
+VideoStream* openVideoStream(const char* target, int format, int width, int height, int frameRate, int numOfFrames)
+{
+	VideoStream* stream = calloc(1, sizeof(VideoStream));
+	if (!stream)
+		return NULL;
+	stream->format = format;
+	stream->width = width;
+	stream->height = height;
+	if (format == VIDEO_Y4M)
+		stream->frameSize = strlen(Y4M_FRAME_HEADER) + (size_t)width * height +
+			2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+	else
+		stream->frameSize = (size_t)width * height * 3;
+
+	if (strcmp(target, "-") == 0)
+	{
+		stream->file = stdout;
+		stream->isStdout = 1;
+#ifdef _WIN64
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	}
+	else if (target[0] == '|')
+	{
+		stream->file = popen(target + 1, PIPE_WRITE_MODE);
+		stream->isPipe = 1;
+	}
+	else
+	{
+		stream->file = fopen(target, "wb");
+		if (stream->file && numOfFrames > 0)
+		{
+			stream->numOfPreallocatedFrames = numOfFrames;
+			preallocateFile(stream->file, stream->frameSize * numOfFrames + 64);
+		}
+	}
+	if (!stream->file)
+	{
+		fprintf(stderr, "failed to open the video stream %s\n", target);
+		free(stream);
+		return NULL;
+	}
+	setvbuf(stream->file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+	// C420jpeg, chroma is centered between the luma samples
+	if (format == VIDEO_Y4M)
+		fprintf(stream->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, frameRate);
+	return stream;
+}
+
+size_t getVideoFrameSize(VideoStream* stream)
+{
+	return stream->frameSize;
+}
+
+static unsigned char clampToByte(float value)
+{
+	return (unsigned char)(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value + 0.5f));
+}
+
+// Converts an RGB(A) image into one frame of getVideoFrameSize bytes. Touches
+// no state of the stream, so frames can be encoded on several threads.
+int encodeVideoFrame(VideoStream* stream, const unsigned char* data, int comp, int stride,
+	unsigned int isFlipped, unsigned char* frame)
+{
+	int width = stream->width;
+	int height = stream->height;
+	if (comp < 3)
+		return 0;
+	if (stride == 0)
+		stride = width * comp;
+
+	if (stream->format == VIDEO_RAW_RGB)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* row = data + (size_t)stride * (isFlipped ? height - 1 - y : y);
+			unsigned char* destination = &frame[(size_t)y * width * 3];
+			for (int x = 0; x < width; x++)
+				memcpy(&destination[x * 3], &row[x * comp], 3);
+		}
+		return 1;
+	}
+
+	// BT.601 studio range, the chroma of a 2x2 block is the average of its pixels
+	int chromaWidth = (width + 1) / 2;
+	int chromaHeight = (height + 1) / 2;
+	memcpy(frame, Y4M_FRAME_HEADER, strlen(Y4M_FRAME_HEADER));
+	unsigned char* luma = frame + strlen(Y4M_FRAME_HEADER);
+	unsigned char* chromaU = luma + (size_t)width * height;
+	unsigned char* chromaV = chromaU + (size_t)chromaWidth * chromaHeight;
+	for (int chromaY = 0; chromaY < chromaHeight; chromaY++)
+	{
+		for (int chromaX = 0; chromaX < chromaWidth; chromaX++)
+		{
+			float sumU = 0.0f, sumV = 0.0f;
+			int count = 0;
+			for (int y = chromaY * 2; y < MIN(chromaY * 2 + 2, height); y++)
+			{
+				const unsigned char* row = data + (size_t)stride * (isFlipped ? height - 1 - y : y);
+				for (int x = chromaX * 2; x < MIN(chromaX * 2 + 2, width); x++)
+				{
+					float r = row[x * comp], g = row[x * comp + 1], b = row[x * comp + 2];
+					luma[(size_t)y * width + x] = clampToByte(16.0f + 0.257f * r + 0.504f * g + 0.098f * b);
+					sumU += -0.148f * r - 0.291f * g + 0.439f * b;
+					sumV += 0.439f * r - 0.368f * g - 0.071f * b;
+					count++;
+				}
+			}
+			chromaU[(size_t)chromaY * chromaWidth + chromaX] = clampToByte(128.0f + sumU / count);
+			chromaV[(size_t)chromaY * chromaWidth + chromaX] = clampToByte(128.0f + sumV / count);
+		}
+	}
+	return 1;
+}
+
+// frames have to be written in order, from one thread at a time
+int writeVideoFrame(VideoStream* stream, const unsigned char* frame)
+{
+	if (fwrite(frame, 1, stream->frameSize, stream->file) != stream->frameSize)
+	{
+		fprintf(stderr, "failed to write video frame %zu\n", stream->numOfFrames);
+		return 0;
+	}
+	stream->numOfFrames++;
+	return 1;
+}
+
+void closeVideoStream(VideoStream* stream)
+{
+	if (!stream)
+		return;
+	if (stream->isStdout)
+		fflush(stream->file);
+	else if (stream->isPipe)
+		pclose(stream->file);
+	else
+	{
+		// the preallocated space which was not written is cut off
+		if (stream->numOfPreallocatedFrames > 0)
+			truncateFile(stream->file, (size_t)ftell(stream->file));
+		fclose(stream->file);
+	}
+	free(stream);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+
+#define VIDEO_FRAME_RATE (30)
+
+// VIDEO_Y4M is YUV 4:2:0 in a YUV4MPEG2 stream, VIDEO_RAW_RGB is the bare RGB frames one after another
+enum videoFormat { VIDEO_Y4M = 0, VIDEO_RAW_RGB = 1 };
+
+// Frame sink for ffmpeg or other consumers reading a video stream.
+// The target is "-" for stdout, "|command" to pipe into the command, or a
+// file path. A file is preallocated for numOfFrames frames when it is known.
+typedef struct VideoStream VideoStream;
+
+int getVideoFormat(const char* target);
+VideoStream* openVideoStream(const char* target, int format, int width, int height, int frameRate, int numOfFrames);
+size_t getVideoFrameSize(VideoStream* stream);
+int encodeVideoFrame(VideoStream* stream, const unsigned char* data, int comp, int stride,
+	unsigned int isFlipped, unsigned char* frame);
+int writeVideoFrame(VideoStream* stream, const unsigned char* frame);
+void closeVideoStream(VideoStream* stream);